@@ -0,0 +1,483 @@
+// Microbenchmarks of the CPU-side hot paths: detector output parsing, YOLO box
+// filtering, tracker matching, area lookups, tracking and collision detection.
+// They run on synthetic tensors and tracks, no model or video is needed.
+//
+// Usage: smart_city_bench [name filter] [-min_time <ms>] [-check]
+//
+// Every benchmark processes N objects per operation, N from 10 to 1000, and
+// reports ns/op and heap allocations/op. Checks of the SSD parsing, the YOLO
+// box filtering, the YOLO parsing of partial batches and the collision
+// detection run first; -check only runs them, and is what ctest runs.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "object_detection.hpp"
+#include "yolo_detection.hpp"
+#include "yolo_labels.hpp"
+#include "Tracker.h"
+
+// ----------------------------------------------------------------------------------------------------
+// Allocation counting: every operator new of the process goes through here
+// ----------------------------------------------------------------------------------------------------
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Runner
+// ----------------------------------------------------------------------------------------------------
+static const size_t OBJECT_COUNTS[] = {10, 100, 1000};
+
+struct BenchOptions
+{
+    std::string filter;
+    double minTimeMs = 200;
+};
+
+// Run op until minTimeMs elapsed, after one warm-up call, and print the cost of one call
+static void Run(const BenchOptions &options, const std::string &name, size_t objects, const std::function<void()> &op)
+{
+    const std::string label = name + "/" + std::to_string(objects);
+    if (label.find(options.filter) == std::string::npos) {
+        return;
+    }
+    op();
+    uint64_t iterations = 0;
+    uint64_t batch = 1;
+    const uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::high_resolution_clock::now();
+    double elapsedMs = 0;
+    while (elapsedMs < options.minTimeMs) {
+        for (uint64_t i = 0; i < batch; i++) {
+            op();
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    const double allocationsPerOp = static_cast<double>(allocations.load(std::memory_order_relaxed) - allocationsBefore) / iterations;
+    std::cout << std::left << std::setw(32) << label << std::right << std::fixed
+              << std::setw(16) << std::setprecision(1) << elapsedMs * 1e6 / iterations << " ns/op"
+              << std::setw(12) << std::setprecision(1) << allocationsPerOp << " allocs/op"
+              << std::setw(12) << iterations << " ops" << std::endl;
+}
+
+// Deterministic pseudo-random numbers, so every run measures the same inputs
+class Lcg
+{
+private:
+    uint32_t state;
+
+public:
+    explicit Lcg(uint32_t seed) : state(seed) {}
+
+    float uniform()
+    {
+        this->state = this->state * 1664525u + 1013904223u;
+        return (this->state >> 8) / static_cast<float>(1 << 24);
+    }
+};
+
+// Boxes of 160x120 on a grid, so tracks do not overlap whatever their number
+static std::vector<std::pair<cv::Rect, int>> GridDetections(size_t objects, int shift, cv::Size &frameSize)
+{
+    const int cols = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(objects))));
+    const int rows = static_cast<int>((objects + cols - 1) / cols);
+    frameSize = cv::Size(cols * 200, rows * 150);
+    std::vector<std::pair<cv::Rect, int>> detections;
+    for (size_t i = 0; i < objects; i++) {
+        const int x = static_cast<int>(i % cols) * 200 + 20 + shift;
+        const int y = static_cast<int>(i / cols) * 150 + 15;
+        // Cars this small are filtered by the tracker, trucks are not
+        detections.emplace_back(cv::Rect(x, y, 160, 120), i % 2 ? LABEL_TRUCK : LABEL_PERSON);
+    }
+    return detections;
+}
+
+// One lane of cars closer than their length, so every car overlaps its neighbours. The cars
+// grow with the lane to stay above the 0.009 of the frame area under which the tracker drops them
+static std::vector<std::pair<cv::Rect, int>> LaneDetections(size_t objects, int shift, cv::Size &frameSize)
+{
+    const int spacing = 60;
+    const int height = 80;
+    // Room for the cars to move forward
+    frameSize = cv::Size(static_cast<int>(objects) * spacing + 100, 100);
+    const int width = std::max(160, frameSize.area() / 100 / height + 1);
+    std::vector<std::pair<cv::Rect, int>> detections;
+    for (size_t i = 0; i < objects; i++) {
+        // Centred on its slot, the cars at both ends stick out of the frame
+        const int x = static_cast<int>(i) * spacing + spacing / 2 - width / 2 + shift;
+        detections.emplace_back(cv::Rect(x, 10, width, height), LABEL_CAR);
+    }
+    return detections;
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Detector post-processing
+// ----------------------------------------------------------------------------------------------------
+
+// YOLOv3 416x416 outputs: 13, 26 and 52 cells a side, 3 anchors of 80 classes each.
+// objects cells of the 52 scale are above the threshold.
+static void BenchYoloParse(const BenchOptions &options, size_t objects)
+{
+    const int coords = 4;
+    const int classes = 80;
+    const int num = 3;
+    const std::vector<float> anchors = {10.0, 13.0, 16.0, 30.0, 33.0, 23.0, 30.0, 61.0, 62.0, 45.0, 59.0, 119.0, 116.0, 90.0, 156.0, 198.0, 373.0, 326.0};
+    const int sides[] = {13, 26, 52};
+    const int anchorOffsets[] = {12, 6, 0};
+    std::vector<std::vector<float>> blobs;
+    Lcg random(1);
+    for (int side : sides) {
+        std::vector<float> blob(static_cast<size_t>(num) * (coords + 1 + classes) * side * side);
+        for (auto && value : blob) {
+            value = random.uniform() * 0.1f;
+        }
+        if (side == 52) {
+            const int sideSquare = side * side;
+            for (size_t o = 0; o < objects; o++) {
+                const int location = static_cast<int>(o * (num * sideSquare) / objects);
+                const int n = location / sideSquare;
+                const int cell = location % sideSquare;
+                float *entry = blob.data() + n * sideSquare * (coords + 1 + classes) + cell;
+                entry[coords * sideSquare] = 0.9f;
+                entry[(coords + 1 + static_cast<int>(o % classes)) * sideSquare] = 0.9f;
+            }
+        }
+        blobs.push_back(std::move(blob));
+    }
+    std::vector<DetectionObject> detected;
+    Run(options, "yolo_parse", objects, [&] {
+        detected.clear();
+        for (size_t s = 0; s < blobs.size(); s++) {
+            ParseYOLOV3Region(blobs[s].data(), sides[s], num, coords, classes, anchors.data() + anchorOffsets[s],
+                              416, 416, 1080, 1920, 0.5, detected);
+        }
+    });
+}
+
+// SSD proposals are kept above the threshold, up to the end marker, scaled to the
+// region of their frame and moved to its position in the frame
+static void CheckSsdParse()
+{
+    const int objectSize = 7;
+    const std::vector<cv::Rect> frameRegions = {cv::Rect(0, 0, 1000, 500), cv::Rect(100, 50, 400, 200)};
+    const std::vector<float> detections = {
+        1, LABEL_CAR, 0.9f, 0.25f, 0.5f, 0.75f, 1.0f,       // Kept, in the second frame
+        0, LABEL_PERSON, 0.4f, 0.0f, 0.0f, 0.1f, 0.1f,      // Below the threshold
+        0, LABEL_PERSON, 0.8f, 0.1f, 0.2f, 0.3f, 0.4f,      // Kept, in the first frame
+        -1, 0, 0, 0, 0, 0, 0,                               // End of the detections
+        0, LABEL_CAR, 0.9f, 0.0f, 0.0f, 0.5f, 0.5f};        // Past the end, ignored
+    std::vector<BaseDetection::Result> results;
+    ParseSSDOutput(detections.data(), static_cast<int>(detections.size() / objectSize), objectSize, 0.5f, frameRegions, results);
+    if (results.size() != 2) {
+        throw std::logic_error("ssd_parse: " + std::to_string(results.size()) + " results instead of 2");
+    }
+    if (results[0].batchIndex != 1 || results[0].label != LABEL_CAR || results[0].location != cv::Rect(200, 150, 200, 100)) {
+        throw std::logic_error("ssd_parse: the box of the second frame is not in its region");
+    }
+    if (results[1].batchIndex != 0 || results[1].label != LABEL_PERSON || results[1].location != cv::Rect(100, 100, 200, 100)) {
+        throw std::logic_error("ssd_parse: the box of the first frame is misplaced");
+    }
+}
+
+// Of two boxes overlapping beyond the IoU threshold only the most confident one is
+// kept, a box apart from them is kept whatever its confidence
+static void CheckYoloFilter()
+{
+    std::vector<DetectionObject> objects = {
+        DetectionObject(100, 100, 50, 50, 0, 0.6f, 1, 1),
+        DetectionObject(105, 100, 50, 50, 0, 0.9f, 1, 1),
+        DetectionObject(300, 300, 50, 50, 0, 0.5f, 1, 1)};
+    FilterOverlappingBoxes(objects, 0.4f);
+    std::vector<float> kept;
+    for (auto && object : objects) {
+        if (object.confidence > 0) {
+            kept.push_back(object.confidence);
+        }
+    }
+    std::sort(kept.begin(), kept.end());
+    if (kept != std::vector<float>{0.5f, 0.9f}) {
+        throw std::logic_error("yolo_filter_boxes: the boxes kept are not the 0.9 and 0.5 ones");
+    }
+}
+
+// YOLO may take fewer frames than a batch of the pipeline, -n_y 1 under -n 4: the frames
+// past its batch size were not enqueued and get no results, rather than be looked up in the blob
+static void CheckYoloPartialBatch()
+{
+    const int side = 13;
+    const int coords = 4;
+    const int classes = 80;
+    InferenceEngine::CNNLayerPtr layer = std::make_shared<InferenceEngine::CNNLayer>(
+        InferenceEngine::LayerParams{"yolo_13", "RegionYolo", InferenceEngine::Precision::FP32});
+    layer->params["num"] = "9";
+    layer->params["mask"] = "6,7,8";
+    layer->params["coords"] = std::to_string(coords);
+    layer->params["classes"] = std::to_string(classes);
+    layer->params["anchors"] = "10,13,16,30,33,23,30,61,62,45,59,119,116,90,156,198,373,326";
+    InferenceEngine::Blob::Ptr blob = InferenceEngine::make_shared_blob<float>(InferenceEngine::TensorDesc(
+        InferenceEngine::Precision::FP32, {1, 3 * (coords + 1 + classes), side, side}, InferenceEngine::Layout::NCHW));
+    blob->allocate();
+    float *data = blob->buffer().as<float *>();
+    std::fill(data, data + blob->size(), 0.0f);
+    // One object in the first cell, first anchor and first class
+    data[coords * side * side] = 0.9f;
+    data[(coords + 1) * side * side] = 0.9f;
+
+    const std::vector<cv::Rect> frameRegions(4, cv::Rect(0, 0, 1920, 1080));
+    std::vector<BaseDetection::Result> results;
+    ParseYOLOV3Batch({std::make_pair(layer, blob)}, frameRegions, 1, 416, 416, 0.5, 0.4, results);
+    if (results.empty()) {
+        throw std::logic_error("yolo_partial_batch: the enqueued frame has no results");
+    }
+    for (auto && result : results) {
+        if (result.batchIndex != 0) {
+            throw std::logic_error("yolo_partial_batch: frame " + std::to_string(result.batchIndex) + " was not enqueued but has results");
+        }
+    }
+}
+
+static void BenchYoloFilter(const BenchOptions &options, size_t objects)
+{
+    std::vector<DetectionObject> candidates;
+    Lcg random(2);
+    for (size_t o = 0; o < objects; o++) {
+        candidates.emplace_back(random.uniform() * 416, random.uniform() * 416, 20 + random.uniform() * 80, 20 + random.uniform() * 80,
+                                static_cast<int>(o % 80), 0.5f + random.uniform() * 0.5f, 1080.f / 416, 1920.f / 416);
+    }
+    std::vector<DetectionObject> objectsToFilter;
+    objectsToFilter.reserve(objects);
+    Run(options, "yolo_filter_boxes", objects, [&] {
+        objectsToFilter.assign(candidates.begin(), candidates.end());
+        FilterOverlappingBoxes(objectsToFilter, 0.4f);
+    });
+}
+
+// SSD DetectionOutput of objects proposals over a batch of 4 frames
+static void BenchSsdParse(const BenchOptions &options, size_t objects)
+{
+    const int objectSize = 7;
+    const std::vector<cv::Rect> frameRegions(4, cv::Rect(0, 0, 1920, 1080));
+    std::vector<float> detections(objects * objectSize);
+    Lcg random(3);
+    for (size_t o = 0; o < objects; o++) {
+        float *proposal = detections.data() + o * objectSize;
+        const float x = random.uniform() * 0.9f;
+        const float y = random.uniform() * 0.9f;
+        proposal[0] = static_cast<float>(o % frameRegions.size());
+        proposal[1] = static_cast<float>(o % 2 ? LABEL_CAR : LABEL_PERSON);
+        proposal[2] = 0.3f + random.uniform() * 0.7f;
+        proposal[3] = x;
+        proposal[4] = y;
+        proposal[5] = x + 0.05f;
+        proposal[6] = y + 0.05f;
+    }
+    std::vector<BaseDetection::Result> results;
+    Run(options, "ssd_parse", objects, [&] {
+        results.clear();
+        ParseSSDOutput(detections.data(), static_cast<int>(objects), objectSize, 0.5f, frameRegions, results);
+    });
+}
+
+// ----------------------------------------------------------------------------------------------------
+// Tracking
+// ----------------------------------------------------------------------------------------------------
+
+// Matching every detection of a frame against objects tracks, as updateTrackingSystem does
+static void BenchFindTracker(const BenchOptions &options, size_t objects)
+{
+    cv::Size frameSize;
+    const std::vector<std::pair<cv::Rect, int>> detections = GridDetections(objects, 0, frameSize);
+    const std::vector<std::pair<cv::Rect, int>> moved = GridDetections(objects, 3, frameSize);
+    TrackerManager manager;
+    for (size_t i = 0; i < detections.size(); i++) {
+        manager.insertTracker(std::make_shared<SingleTracker>(static_cast<int>(i), detections[i].first,
+                                                              getLabelColor(detections[i].second), detections[i].second), false);
+    }
+    volatile int sink = 0;
+    Run(options, "find_tracker", objects, [&] {
+        for (auto && detection : moved) {
+            sink = manager.findTracker(detection.first, detection.second);
+        }
+    });
+}
+
+// Area lookup of objects positions in a 1920x1080 mask with one drawn area
+static void BenchIsInsideMask(const BenchOptions &options, size_t objects)
+{
+    cv::Mat mask(1080, 1920, CV_8UC3, cv::Scalar::all(0));
+    const std::vector<cv::Point> area = {cv::Point(400, 300), cv::Point(1500, 250), cv::Point(1700, 900), cv::Point(300, 850)};
+    cv::fillConvexPoly(mask, area, cv::Scalar::all(255));
+    std::vector<cv::Point2f> positions;
+    Lcg random(4);
+    for (size_t o = 0; o < objects; o++) {
+        positions.emplace_back(random.uniform() * 1920, random.uniform() * 1080);
+    }
+    volatile int sink = 0;
+    Run(options, "is_inside_mask", objects, [&] {
+        for (auto && position : positions) {
+            sink = isInsideMask(&mask, &position);
+        }
+    });
+}
+
+// Tracking system following objects tracks, detections alternating between two positions
+struct SyntheticTracking
+{
+    std::string lastEvent;
+    TrackingSystem system;
+    std::vector<std::pair<cv::Rect, int>> detections[2];
+    cv::Mat frame;
+    size_t step = 0;
+
+    explicit SyntheticTracking(size_t objects) : system(&lastEvent)
+    {
+        cv::Size frameSize;
+        this->detections[0] = GridDetections(objects, 0, frameSize);
+        this->detections[1] = GridDetections(objects, 2, frameSize);
+        this->system.setFrameWidth(frameSize.width);
+        this->system.setFrameHeight(frameSize.height);
+        this->system.setInitTarget(this->detections[0]);
+        this->system.initTrackingSystem();
+        // Pixels are never read without areas of interest, only the frame size matters
+        this->frame = cv::Mat(48, 64, CV_8UC3, cv::Scalar::all(0));
+        // Enough history for the velocity and acceleration windows of the collision detection
+        for (int i = 0; i < 8; i++) {
+            this->track();
+        }
+    }
+
+    void track()
+    {
+        this->system.updateTrackingSystem(this->detections[this->step++ % 2]);
+        this->system.startTracking(this->frame);
+    }
+};
+
+// One detected frame: updateTrackingSystem followed by startTracking
+static void BenchTracking(const BenchOptions &options, size_t objects)
+{
+    SyntheticTracking tracking(objects);
+    Run(options, "update_and_track", objects, [&] { tracking.track(); });
+}
+
+// Tracking system following a lane of cars standing still, then setting off together in the
+// last frames: every car trips the acceleration thresholds of the collision detection
+struct SyntheticLane
+{
+    std::string lastEvent;
+    TrackingSystem system;
+    cv::Mat frame;
+
+    explicit SyntheticLane(size_t objects) : system(&lastEvent)
+    {
+        cv::Size frameSize;
+        this->system.setInitTarget(LaneDetections(objects, 0, frameSize));
+        this->system.setFrameWidth(frameSize.width);
+        this->system.setFrameHeight(frameSize.height);
+        this->system.initTrackingSystem();
+        this->frame = cv::Mat(48, 64, CV_8UC3, cv::Scalar::all(0));
+        // Steps shorter than half the spacing, so every detection keeps its track
+        for (int i = 0; i < 15; i++) {
+            this->system.updateTrackingSystem(LaneDetections(objects, std::max(0, i - 11) * 20, frameSize));
+            this->system.startTracking(this->frame);
+        }
+    }
+};
+
+// Every car of the lane is a near miss and, overlapping a near miss, a collision
+static void CheckCollisions()
+{
+    SyntheticLane lane(10);
+    lane.system.detectCollisions();
+    const std::vector<std::shared_ptr<SingleTracker>> trackers = lane.system.getTrackerManager().getTrackerVec();
+    if (trackers.size() != 10) {
+        throw std::logic_error("detect_collisions: " + std::to_string(trackers.size()) + " cars tracked instead of 10");
+    }
+    for (const auto &tracker : trackers) {
+        if (!tracker->getNearMiss() || !tracker->getCollision()) {
+            throw std::logic_error("detect_collisions: car " + std::to_string(tracker->getTargetID()) + " is not a collision");
+        }
+    }
+}
+
+static void BenchCollisions(const BenchOptions &options, size_t objects)
+{
+    SyntheticLane lane(objects);
+    Run(options, "detect_collisions", objects, [&] { lane.system.detectCollisions(); });
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    bool checkOnly = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-min_time" && i + 1 < argc) {
+            options.minTimeMs = std::atof(argv[++i]);
+        } else if (arg == "-check") {
+            checkOnly = true;
+        } else {
+            options.filter = arg;
+        }
+    }
+    // The tracker logs every object of every frame, measure the computations only
+    boost::log::core::get()->set_logging_enabled(false);
+
+    try {
+        CheckSsdParse();
+        CheckYoloFilter();
+        CheckYoloPartialBatch();
+        CheckCollisions();
+    } catch (const std::exception &error) {
+        std::cerr << "Check failed: " << error.what() << std::endl;
+        return 1;
+    }
+    if (checkOnly) {
+        std::cout << "Checks passed" << std::endl;
+        return 0;
+    }
+
+    const std::vector<std::function<void(const BenchOptions &, size_t)>> benchmarks = {
+        BenchYoloParse, BenchYoloFilter, BenchSsdParse, BenchFindTracker, BenchIsInsideMask, BenchTracking, BenchCollisions};
+    for (auto && benchmark : benchmarks) {
+        for (size_t objects : OBJECT_COUNTS) {
+            benchmark(options, objects);
+        }
+    }
+    return 0;
+}
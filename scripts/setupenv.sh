@@ -28,6 +28,8 @@ fi
 modName=person-vehicle-bike-detection-crossroad-0078
 export vehicle216=$modelDir/FP16/$modName.xml
 export vehicle232=$modelDir/FP32/$modName.xml
+# Quantized from vehicle232 with a set dumped by -calib_out
+export vehicle2i8=$modelDir/INT8/$modName.xml
 
 modName=frozen_yolo_v3
 export yolo16=$parent_path/../data/$modName.xml
@@ -669,7 +669,7 @@ int TrackingSystem::updateTrackingSystem(std::vector<std::pair<cv::Rect, int>> u
 		}
 	}
 #ifdef ENABLED_DB
-	this->dbWrite(&this->events, &this->buffer_events);
+	this->dbWriteAsync(&this->events, &this->buffer_events);
 #endif
 	return SUCCESS;
 }
@@ -705,32 +705,34 @@ int TrackingSystem::startTracking(cv::Mat& _mat_img)
 		}
 	});
 
-	std::vector<std::thread> thread_pool;
-
 	std::vector<cv::Mat>* mask_sw = this->mask_sidewalks;
 
 	std::vector<cv::Mat>* mask_cw = this->mask_crosswalks;
 
 	std::vector<std::pair<cv::Mat, int>>* mask_str = this->mask_streets;
 
-	Pipe* buffer = &this->buffer_tracker;
-
 	int* tFrames = &this->totalFrames;
 
 	bool dbEn = this->dbEnable;
 
-	// Multi thread
-	std::for_each(manager.getTrackerVec().begin(), manager.getTrackerVec().end(), [&thread_pool, &_mat_img, &mask_sw, &mask_cw, &mask_str, &buffer, &tFrames, &dbEn](std::shared_ptr<SingleTracker> ptr) {
-		thread_pool.emplace_back([ptr, &_mat_img, &mask_sw, &mask_cw, &mask_str, &buffer, &tFrames, dbEn]() {
-		 ptr.get()->doSingleTracking(&_mat_img, mask_sw, mask_cw, mask_str, buffer, tFrames, dbEn);
-		});
-	});
-
-	for (int i = 0; i < thread_pool.size(); i++)
-		thread_pool[i].join();
+	std::vector<std::shared_ptr<SingleTracker>>& trackers = manager.getTrackerVec();
+	std::mutex buffer_mutex;
+	// Every chunk of trackers fills its own buffer, appended to buffer_tracker at its end
+	auto trackChunk = [&](size_t begin, size_t end) {
+		Pipe chunk_buffer;
+		for (size_t i = begin; i < end; i++)
+			trackers[i]->doSingleTracking(&_mat_img, mask_sw, mask_cw, mask_str, &chunk_buffer, tFrames, dbEn);
+		std::lock_guard<std::mutex> lock(buffer_mutex);
+		this->buffer_tracker.insert(this->buffer_tracker.end(), chunk_buffer.begin(), chunk_buffer.end());
+	};
+	// Multi thread, on the tracking pool
+	if (this->tracking_pool != nullptr)
+		this->tracking_pool->parallelFor(trackers.size(), 4, trackChunk);
+	else
+		trackChunk(0, trackers.size());
 
 #ifdef ENABLED_DB
-	std::thread t1(&TrackingSystem::dbWrite, this, &this->tracker, &this->buffer_tracker);
+	this->dbWriteAsync(&this->tracker, &this->buffer_tracker);
 #endif
 	std::vector<int> tracker_erase;
 	for(auto && i: manager.getTrackerVec()) {
@@ -766,8 +768,7 @@ int TrackingSystem::startTracking(cv::Mat& _mat_img)
 	}
 
 #ifdef ENABLED_DB
-	this->dbWrite(&this->events, &this->buffer_events);
-	t1.join();
+	this->dbWriteAsync(&this->events, &this->buffer_events);
 #endif
 
 	return SUCCESS;
@@ -913,6 +914,7 @@ void TrackingSystem::dbWrite(mongocxx::v_noabi::collection* col, Pipe* buffer_pt
 	//std::this_thread::sleep_for(std::chrono::microseconds(10));
 	if(buffer_ptr->size() != 0){
 		
+	StageTimer timer(this->stats, PipelineStats::Database);
 	std::vector<bsoncxx::document::value> documents;
 	while(buffer_ptr->size() != 0){
         //std::cout << "thread" << buffer_ptr->size() << std::endl;
@@ -943,16 +945,34 @@ void TrackingSystem::dbWrite(mongocxx::v_noabi::collection* col, Pipe* buffer_pt
 	}
 }
 
-void TrackingSystem::setUpCollections(){
+void TrackingSystem::dbWriteAsync(mongocxx::v_noabi::collection* col, Pipe* buffer_ptr){
+	if(buffer_ptr->size() == 0)
+		return;
+	if(this -> io_pool == nullptr){
+		this -> dbWrite(col, buffer_ptr);
+		return;
+	}
+	// The task owns the documents, the tracker keeps filling an empty buffer
+	std::shared_ptr<Pipe> documents = std::make_shared<Pipe>();
+	documents -> swap(*buffer_ptr);
+	this -> io_pool -> submit([this, col, documents]() {
+		this -> dbWrite(col, documents.get());
+	});
+}
+
+void TrackingSystem::setUpCollections(const std::string &suffix){
+	// mongocxx allows a single driver instance per process
+	static mongocxx::instance inst{};
+	this -> conn = mongocxx::client{mongocxx::uri{}};
 	this -> conn.start_session();
 	this -> dbEnable = true;
-	this -> tracker = this -> conn["smart_city_metadata"]["tracker_data"];
+	this -> tracker = this -> conn["smart_city_metadata"]["tracker_data" + suffix];
 	this -> tracker.drop();
 	this -> tracker.insert_one({});
-	this -> collisions = this -> conn["smart_city_metadata"]["collisions_data"];
+	this -> collisions = this -> conn["smart_city_metadata"]["collisions_data" + suffix];
 	this -> collisions.drop();
 	this -> collisions.insert_one({});
-	this -> events = this -> conn["smart_city_metadata"]["events"];
+	this -> events = this -> conn["smart_city_metadata"]["events" + suffix];
 	this -> events.drop();
 	this -> events.insert_one({});
 
@@ -1046,7 +1066,7 @@ int TrackingSystem::detectCollisions()
 				document.objectClass = getLabelStr(iRef.getLabel());
 				this->buffer_events.push_back(document); 
 			}
-			std::thread t3(&TrackingSystem::dbWrite, this, &this->events, &this->buffer_events);
+			this->dbWriteAsync(&this->events, &this->buffer_events);
 #endif
 			iRef.setNearMiss(true);
 			for (auto j = trackerVec.begin(); j != trackerVec.end(); ++j) {
@@ -1075,8 +1095,15 @@ int TrackingSystem::detectCollisions()
 						document.ob2 = ob2;
 						this->buffer_collisions.push_back(document); 
 					}
+					if(this -> keep_history){
+						PipeItem document;
+						document.frame = totalFrames;
+						document.ob1 = ob1;
+						document.ob2 = ob2;
+						this->collision_history.push_back(document);
+					}
 #ifdef ENABLED_DB
-					std::thread t2(&TrackingSystem::dbWrite, this, &this->collisions, &this->buffer_collisions);
+					this->dbWriteAsync(&this->collisions, &this->buffer_collisions);
 #endif
 					BOOST_LOG_TRIVIAL(error)<< "$" << totalFrames << "$Collision between object $"<<iRef.getTargetID()<<"$ and $"<< jRef.getTargetID() << "$";
 					
@@ -1090,14 +1117,8 @@ int TrackingSystem::detectCollisions()
 						iRef.setColor(cv::Scalar(0,165,255)); // Orange
 						jRef.setColor(cv::Scalar(0,165,255));
 					}
-#ifdef ENABLED_DB
-					t2.join();
-#endif
 				}
 			}
-#ifdef ENABLED_DB
-			t3.join();
-#endif
 		}
 	}
 	
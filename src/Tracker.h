@@ -11,6 +11,8 @@
 #include <opencv2/core.hpp>
 #include <boost/circular_buffer.hpp>
 #include "yolo_labels.hpp"
+#include "latency_stats.hpp"
+#include "thread_pool.hpp"
 
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
@@ -63,6 +65,10 @@ typedef struct
 			std::string objectClass = "";
 		}PipeItem;
 typedef std::vector<PipeItem> Pipe;
+
+// Check if pos is inside the area drawn on mask
+int isInsideMask(cv::Mat * mask, cv::Point2f * pos);
+
 /* ==========================================================================
 
 Class : SingleTracker
@@ -282,8 +288,7 @@ class TrackingSystem
 		int 			totalFrames;
 		bool dbEnable;
 #ifdef ENABLED_DB
-		mongocxx::instance inst{};
-		mongocxx::client conn{mongocxx::uri{}};
+		mongocxx::client conn;	// Connected in setUpCollections, the driver instance is shared by all streams
 		mongocxx::v_noabi::collection  	tracker;
 		mongocxx::v_noabi::collection  	collisions;
 		mongocxx::v_noabi::collection	events; 	
@@ -292,10 +297,16 @@ class TrackingSystem
 		Pipe buffer_tracker;
 		Pipe buffer_collisions;
 		Pipe buffer_events;
+		Pipe collision_history;		// Collisions found so far, kept when keep_history is set
+		bool keep_history;
+		PipelineStats*	stats;		// Database write latency, when set
+		ThreadPool*		tracking_pool;	// Runs the single trackers, sequential when null
+		ThreadPool*		io_pool;		// Runs the database writes, inline when null
 	public:
 		/* Constructor */
 		explicit TrackingSystem(std::string *last_event):last_event(last_event),mask(nullptr),
-					mask_sidewalks(nullptr),mask_streets(nullptr),mask_crosswalks(nullptr), totalFrames(0),dbEnable(false){
+					mask_sidewalks(nullptr),mask_streets(nullptr),mask_crosswalks(nullptr), totalFrames(0),dbEnable(false),keep_history(false),stats(nullptr),
+					tracking_pool(nullptr),io_pool(nullptr){
 					};
 
 	/* Get Function */
@@ -321,6 +332,11 @@ class TrackingSystem
 		this -> mask_crosswalks = _mask_crosswalks;
 	}
 	void saveCrosswalk(cv::Mat _roi) { this->d_cws.push_back(_roi); }
+	void keepCollisionHistory(bool _keep) { this->keep_history = _keep; }
+	void setStats(PipelineStats* _stats) { this->stats = _stats; }
+	// Pools shared by every stream, they must outlive the writes they were given
+	void setThreadPools(ThreadPool* _tracking, ThreadPool* _io) { this->tracking_pool = _tracking; this->io_pool = _io; }
+	Pipe& getCollisionHistory() { return this->collision_history; }
 
 	/* Core Function */
 	// Initialize TrackingSystem
@@ -342,9 +358,12 @@ class TrackingSystem
 	void terminateSystem();
 
 #ifdef ENABLED_DB
-	//clear Mongo collections
-	void setUpCollections();
+	//clear Mongo collections, suffix tells apart the collections of each stream
+	void setUpCollections(const std::string &suffix = "");
 
 	void dbWrite(mongocxx::v_noabi::collection* col, Pipe* buffer_ptr);
+
+	// Hand the documents buffered so far to the I/O pool and empty the buffer
+	void dbWriteAsync(mongocxx::v_noabi::collection* col, Pipe* buffer_ptr);
 #endif
 };
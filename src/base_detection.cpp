@@ -1,20 +1,114 @@
 #include "base_detection.hpp"
 
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+InferenceEngine::Blob::Ptr wrapRegion2Blob(const cv::Mat &region)
+{
+    if (region.isContinuous()) {
+        return wrapMat2Blob(region);
+    }
+    cv::Size frameSize;
+    cv::Point offset;
+    region.locateROI(frameSize, offset);
+    cv::Mat frame(frameSize, region.type(), const_cast<uchar *>(region.datastart), region.step);
+    InferenceEngine::ROI roi(0, offset.x, offset.y, region.cols, region.rows);
+    return InferenceEngine::make_shared_blob(wrapMat2Blob(frame), roi);
+}
+
+void frameRegion2Blob(const FrameRef &frame, InferenceEngine::Blob::Ptr &blob, int batchIndex)
+{
+    const InferenceEngine::SizeVector dims = blob->getTensorDesc().getDims();
+    const cv::Size size(static_cast<int>(dims[3]), static_cast<int>(dims[2]));
+    const size_t imageBytes = dims[1] * dims[2] * dims[3];
+    const cv::Mat tensor = frame.preprocessed(size, true);
+    if (tensor.total() != imageBytes) {
+        throw std::logic_error("The input blob does not have the channels of the frame");
+    }
+    std::memcpy(blob->buffer().as<uint8_t *>() + batchIndex * imageBytes, tensor.data, imageBytes);
+}
+
+std::string IRPrecision(const std::string &xml)
+{
+    std::ifstream file(xml);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + xml);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    const std::string ir = text.str();
+    // Calibrated IRs carry FakeQuantize layers, older ones I8 weights
+    if (ir.find("FakeQuantize") != std::string::npos || ir.find("precision=\"I8\"") != std::string::npos) {
+        return "INT8";
+    }
+    if (ir.find("precision=\"FP16\"") != std::string::npos || ir.find("element_type=\"f16\"") != std::string::npos) {
+        return "FP16";
+    }
+    return "FP32";
+}
+
+void BaseDetection::createRequest()
+{
+    this -> requests[this -> inputRequestIdx] = this -> net.CreateInferRequestPtr();
+    std::shared_ptr<RequestState> state = std::make_shared<RequestState>();
+    this -> requestStates[this -> inputRequestIdx] = state;
+    PipelineEvents *events = this -> events;
+    this -> requests[this -> inputRequestIdx]->SetCompletionCallback(std::function<void()>([state, events] {
+        state->finished = std::chrono::high_resolution_clock::now();
+        state->done.store(true, std::memory_order_release);
+        if (events != nullptr) {
+            events->notify();
+        }
+    }));
+}
+
+void BaseDetection::setAsyncRequests(int n)
+{
+    this -> maxSubmittedRequests = n;
+    this -> activeRequests = n;
+    this -> inputRequestIdx = 0;
+    this -> outputRequest = nullptr;
+    this -> outputRequestIdx = -1;
+    this -> requests.assign(n, nullptr);
+    this -> requestStates.assign(n, nullptr);
+    this -> requestBatches.assign(n, FramePipelineFifoItem());
+    this -> requestFrames.assign(n, 0);
+    this -> submitted.clear();
+}
+
+void BaseDetection::setActiveRequests(int n)
+{
+    this -> activeRequests = std::max(1, std::min(n, this -> maxSubmittedRequests));
+}
+
 void BaseDetection::submitRequest() 
 {
     if (! this -> enabled() || nullptr == this -> requests[this -> inputRequestIdx]) return;
+    RequestState &state = *this -> requestStates[this -> inputRequestIdx];
+    state.done.store(false, std::memory_order_relaxed);
+    state.started = std::chrono::high_resolution_clock::now();
     this -> requests[this -> inputRequestIdx]->StartAsync();
-    this -> submittedRequests.push(this -> requests[this -> inputRequestIdx]);
-    (this -> inputRequestIdx)++;
-    if (this-> inputRequestIdx >= this -> maxSubmittedRequests) {
-	   this -> inputRequestIdx = 0;
+    this -> submitted.push_back(this -> inputRequestIdx);
+}
+
+int BaseDetection::freeRequest() const {
+    for (int idx = 0; idx < this -> maxSubmittedRequests; idx++) {
+        if (std::find(this -> submitted.begin(), this -> submitted.end(), idx) == this -> submitted.end()) {
+            return idx;
+        }
     }
+    return -1;
 }
 
 bool BaseDetection::resultIsReady() {
-   if (this -> submittedRequests.size() < 1) return false;
-   InferenceEngine::StatusCode state = this -> submittedRequests.front()->Wait(InferenceEngine::IInferRequest::WaitMode::STATUS_ONLY);
-   return (InferenceEngine::StatusCode::OK == state);
+   // Flagged by the completion callback, no call into the inference engine
+   for (int idx : this -> submitted) {
+       if (this -> requestStates[idx]->done.load(std::memory_order_acquire)) {
+           return true;
+       }
+   }
+   return false;
 }
 
 void BaseDetection::wait() 
@@ -22,21 +116,29 @@ void BaseDetection::wait()
     if (!this -> enabled()) return;
     // get next request to wait on
     if (nullptr == this -> outputRequest) {
-        if (this -> submittedRequests.size() < 1) return;
-        this -> outputRequest = this -> submittedRequests.front();
-        this -> submittedRequests.pop();
+        if (this -> submitted.empty()) return;
+        auto completed = std::find_if(this -> submitted.begin(), this -> submitted.end(),
+                                      [this](int idx) { return this -> requestStates[idx]->done.load(std::memory_order_acquire); });
+        if (completed == this -> submitted.end()) {
+            completed = this -> submitted.begin();
+        } else if (completed != this -> submitted.begin()) {
+            this -> completedOutOfOrder++;
+        }
+        this -> outputRequestIdx = *completed;
+        this -> outputRequest = this -> requests[*completed];
+        this -> submitted.erase(completed);
     }
-    this -> outputRequest->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
+    this -> outputStatus = this -> outputRequest->Wait(InferenceEngine::IInferRequest::WaitMode::RESULT_READY);
 }
 
 bool BaseDetection::requestsInProcess() {
     // request is in progress if number of outstanding requests is > 0
-    return (this -> submittedRequests.size() > 0);
+    return !this -> submitted.empty();
 }
 
  bool BaseDetection::canSubmitRequest() {
     // ready when another request can be submitted
-    return (this -> submittedRequests.size() < this -> maxSubmittedRequests);
+    return (static_cast<int>(this -> submitted.size()) < this -> activeRequests);
 }
 
 bool BaseDetection::enabled() const  {
@@ -51,54 +153,78 @@ bool BaseDetection::enabled() const  {
 }
 
 // Explicitely override it for children classes
-void BaseDetection::enqueue(const cv::Mat &frame){}
+void BaseDetection::enqueue(const FrameRef &frame){}
 
 // Explicitely override it for children classes
-void BaseDetection::fetchResults(int inputBatchSize){}
+void BaseDetection::fetchResults(const std::vector<cv::Rect> &frameRegions){}
+
+void BaseDetection::waitLoaded() {
+    if (this -> loading.valid()) {
+        this -> loading.get();
+        this -> loading = std::shared_future<void>();
+    }
+}
 
-void BaseDetection::run_inferrence(FramePipelineFifo *in_fifo){
+bool BaseDetection::run_inferrence(FramePipelineFifo *in_fifo){
     FramePipelineFifo& in = *in_fifo; 
+    if (!in.empty()) {
+        this -> waitLoaded();
+    }
     if (!in.empty() && (this ->canSubmitRequest())) {
-        FramePipelineFifoItem ps0i = in.front();
+        this -> inputRequestIdx = this -> freeRequest();
+        FramePipelineFifoItem &ps0i = this -> requestBatches[this -> inputRequestIdx];
+        ps0i = std::move(in.front());
         in.pop();
+        StageTimer timer(this -> stats, PipelineStats::Enqueue);
         for(auto &&  i: ps0i.batchOfInputFrames){
-            cv::Mat* curFrame = i;
-            this -> enqueue(*curFrame);
+            this -> enqueue(i);
         }
         this -> submitRequest();
-        this -> S1toS2.push(ps0i);
-        this -> next_pipe = true;
-    }
-}
-
-void BaseDetection::run_inferrence(FramePipelineFifo *i, FramePipelineFifo *o2){
-    this -> run_inferrence(i);
-    if(this -> next_pipe == true ){
-        this -> next_pipe = false;
-        FramePipelineFifo& in = this -> S1toS2; 
-        FramePipelineFifo& out2 = *o2;
-        FramePipelineFifoItem i2 = in.back();
-        out2.push(i2);
+        return true;
     }
+    return false;
 }
 
 
-void BaseDetection::wait_results(FramePipelineFifo *o){
-    FramePipelineFifo& in = this -> S1toS2; 
+bool BaseDetection::wait_results(FramePipelineFifo *o){
     FramePipelineFifo& out = *o; 
     
     if (((this -> maxSubmittedRequests == 1) && this -> requestsInProcess()) || this -> resultIsReady()) {
         this -> wait();
-        FramePipelineFifoItem ps0s1i = in.front();
-        in.pop();
-        this -> fetchResults(ps0s1i.batchOfInputFrames.size());
+        // Wait() may return before the completion callback ran
+        const RequestState &state = *this -> requestStates[this -> outputRequestIdx];
+        const std::chrono::high_resolution_clock::time_point finished =
+            state.done.load(std::memory_order_acquire) ? state.finished : std::chrono::high_resolution_clock::now();
+        const double inferMs = std::chrono::duration<double, std::milli>(finished - state.started).count();
+        if (this -> stats != nullptr) {
+            (*this -> stats)[PipelineStats::Infer].record(finished - state.started);
+        }
+        // The batch that went with the request, whatever the order requests completed in
+        FramePipelineFifoItem ps0s1i = std::move(this -> requestBatches[this -> outputRequestIdx]);
+        this -> requestBatches[this -> outputRequestIdx] = FramePipelineFifoItem();
+        std::vector<cv::Rect> frameRegions;
+        for (auto && frame : ps0s1i.batchOfInputFrames) {
+            frameRegions.push_back(frame.region());
+        }
+        if (this -> outputStatus == InferenceEngine::StatusCode::OK) {
+            StageTimer timer(this -> stats, PipelineStats::Parse);
+            this -> fetchResults(frameRegions);
+        } else {
+            // The other lanes still get this batch joined, without results from this one
+            BOOST_LOG_TRIVIAL(warning) << this -> topoName << " request failed with status " << this -> outputStatus;
+            this -> results.clear();
+            this -> outputRequest = nullptr;
+        }
         // prepare a FramePipelineFifoItem for each batched frame to get its detection results
         std::vector<FramePipelineFifoItem> batchedFifoItems;
 
         for(int i = 0; i < ps0s1i.batchOfInputFrames.size(); i++){
             FramePipelineFifoItem fpfi;
             fpfi.outputFrame = ps0s1i.batchOfInputFrames[i];
-            fpfi.outputFrame_clean = ps0s1i.batchOfInputFrames_clean[i];
+            fpfi.streamId = ps0s1i.batchOfStreamIds[i];
+            fpfi.readTime = ps0s1i.readTime;
+            fpfi.frameSeq = ps0s1i.batchOfFrameSeqs[i];
+            fpfi.inferMs = inferMs;
             batchedFifoItems.push_back(fpfi);
         }
         // store results for next pipeline stage
@@ -115,5 +241,7 @@ void BaseDetection::wait_results(FramePipelineFifo *o){
             item.pedestriansDetectionDone = false;
             out.push(item);
         }
+        return true;
     }
+    return false;
 }
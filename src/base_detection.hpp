@@ -1,5 +1,6 @@
 #pragma once
 #include <gflags/gflags.h>
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <fstream>
@@ -12,6 +13,9 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <utility>
 
 #include <inference_engine.hpp>
@@ -32,22 +36,51 @@
 #include <boost/log/expressions.hpp>
 #include <boost/log/utility/setup/file.hpp>
 #include <boost/log/utility/setup/common_attributes.hpp>
+#include "frame_pool.hpp"
+#include "pipeline_events.hpp"
+#include "latency_stats.hpp"
+#include "network_cache.hpp"
 
 typedef struct {
-            std::vector<cv::Mat*> batchOfInputFrames;
-            std::vector<cv::Mat*> batchOfInputFrames_clean;
+            std::vector<FrameRef> batchOfInputFrames;
+            std::vector<int> batchOfStreamIds;
+            std::vector<uint64_t> batchOfFrameSeqs;                      // Read order of every frame
 
             bool vehicleDetectionDone;
             bool pedestriansDetectionDone;
             bool generalDetectionDone;
-            cv::Mat* outputFrame;
-            cv::Mat* outputFrame_clean;
+            FrameRef outputFrame;
+            int streamId;
+            uint64_t frameSeq;                                           // Read order of the frame, unique and increasing
+            bool reuseResults;                                           // Static frame, last detections apply
+            std::chrono::high_resolution_clock::time_point readTime;     // When the frames were read
+            double inferMs;                                              // Time the infer request of the frame took
             int numVehiclesInferred;
             int numPedestriansInferred;
             std::vector<std::pair<cv::Rect, int>> resultsLocations;
 } FramePipelineFifoItem;
 typedef std::queue<FramePipelineFifoItem> FramePipelineFifo;
 
+// Results of every detection lane for one frame, joined by the inference stage
+struct DetectedFrame {
+    FramePipelineFifoItem vehicles;
+    FramePipelineFifoItem pedestrians;
+    FramePipelineFifoItem general;
+};
+
+// Wrap a frame, or a sub-Mat view of one, into an input blob without copying
+// the pixels. A view that is not continuous is passed as a ROI blob of its frame.
+InferenceEngine::Blob::Ptr wrapRegion2Blob(const cv::Mat &region);
+
+// Copy the region of a frame into the batchIndex-th image of an NCHW input
+// blob. The resized planes are cached with the frame, so detectors sharing
+// an input shape only resize and re-lay-out the pixels once.
+void frameRegion2Blob(const FrameRef &frame, InferenceEngine::Blob::Ptr &blob, int batchIndex);
+
+// Precision the weights of an IR were saved in: "INT8" for a quantized
+// model, "FP16" or "FP32". Throws std::runtime_error if xml cannot be read.
+std::string IRPrecision(const std::string &xml);
+
 
 class BaseDetection {
   public:
@@ -58,17 +91,41 @@ class BaseDetection {
     std::string topoName;
     int maxBatch;
     int maxSubmittedRequests;
+    int activeRequests;                 // Requests in flight allowed, up to maxSubmittedRequests
     InferenceEngine::Core * plugin;
     int inputRequestIdx;
     InferenceEngine::InferRequest::Ptr outputRequest;
+    InferenceEngine::StatusCode outputStatus;
     std::vector<InferenceEngine::InferRequest::Ptr> requests;
-    std::queue<InferenceEngine::InferRequest::Ptr> submittedRequests;
+    // State of each request shared with its completion callback
+    struct RequestState {
+        std::atomic<bool> done;
+        std::chrono::high_resolution_clock::time_point started;
+        std::chrono::high_resolution_clock::time_point finished;   // Written before done is set
+        RequestState() : done(false) {}
+    };
+    std::vector<std::shared_ptr<RequestState>> requestStates;
+    // Batch of frames submitted with each request
+    std::vector<FramePipelineFifoItem> requestBatches;
+    // Frames enqueued in each request when it was submitted, up to maxBatch
+    std::vector<int> requestFrames;
+    // Indexes of the submitted requests, oldest first. Requests may complete in
+    // any order, the results are put back in frame order by the join stage.
+    std::deque<int> submitted;
+    int outputRequestIdx;
+    uint64_t completedOutOfOrder;
+    // Notified when a request completes, may be null
+    PipelineEvents *events;
+    // Enqueue, inference and result parsing latencies, may be null
+    PipelineStats *stats;
     bool auto_resize;
-    bool next_pipe;
+    bool dynamicBatch;                  // Requests only infer the frames enqueued, set by Load
+    std::shared_future<void> loading;   // Network loading in the background, or deferred to first use, if any
+    std::map<std::string, std::string> pluginConfig;    // Passed to LoadNetwork along with Load's own keys
+    std::string precision;              // Of the IR, set by Load
     float detection_threshold;
     mutable bool enablingChecked = false;
     mutable bool _enabled = false;
-    FramePipelineFifo S1toS2;
 
     struct Result {
         int batchIndex;
@@ -82,9 +139,12 @@ class BaseDetection {
     BaseDetection(std::string &commandLineFlag, std::string &deviceName, std::string topoName, 
                     int maxBatch, int FLAGS_n_async, bool auto_resize, float detection_threshold)
         : commandLineFlag(commandLineFlag), deviceName(deviceName),topoName(topoName), 
-            maxBatch(maxBatch), maxSubmittedRequests(FLAGS_n_async), plugin(nullptr), 
-            inputRequestIdx(0), outputRequest(nullptr), requests(FLAGS_n_async), 
-            auto_resize(auto_resize), detection_threshold(detection_threshold) {}
+            maxBatch(maxBatch), maxSubmittedRequests(FLAGS_n_async), activeRequests(FLAGS_n_async), plugin(nullptr), 
+            inputRequestIdx(0), outputRequest(nullptr), outputStatus(InferenceEngine::StatusCode::OK),
+            requests(FLAGS_n_async), requestStates(FLAGS_n_async), requestBatches(FLAGS_n_async),
+            requestFrames(FLAGS_n_async, 0),
+            outputRequestIdx(-1), completedOutOfOrder(0), events(nullptr), stats(nullptr),
+            auto_resize(auto_resize), dynamicBatch(false), detection_threshold(detection_threshold) {}
 
     virtual ~BaseDetection() {}
 
@@ -95,25 +155,48 @@ class BaseDetection {
 
     virtual void submitRequest();
 
-    // call before wait() to check status
+    // Create the infer request at inputRequestIdx, with a completion callback
+    // timestamping and flagging it as done and notifying the pipeline events
+    void createRequest();
+
+    // Drop the infer requests and use n of them from now on
+    void setAsyncRequests(int n);
+
+    // Limit the requests in flight to n, between 1 and maxSubmittedRequests.
+    // Requests already submitted complete normally.
+    void setActiveRequests(int n);
+
+    // First request not submitted yet
+    int freeRequest() const;
+
+    // call before wait() to check status, does not block
     bool resultIsReady();
 
+    // Take a completed request, or the oldest one if none completed yet, and wait for it
     virtual void wait();
 
-    virtual void enqueue(const cv::Mat &frame);
+    virtual void enqueue(const FrameRef &frame);
 
-    virtual void fetchResults(int inputBatchSize);
+    // frameRegions holds the area of every frame in the batch fed to the
+    // detector, results are translated back into frame coordinates
+    virtual void fetchResults(const std::vector<cv::Rect> &frameRegions);
 
-    void run_inferrence(FramePipelineFifo *i);
-    void run_inferrence(FramePipelineFifo *i, FramePipelineFifo *o2);
+    // Both return true when they made progress, so the caller knows when it can sleep
+    bool run_inferrence(FramePipelineFifo *i);
 
-    void wait_results(FramePipelineFifo *o);
+    // Push one item per frame of the oldest completed batch, tagged with its
+    // frameSeq. A failed request yields items without results.
+    bool wait_results(FramePipelineFifo *o);
 
     bool requestsInProcess();
 
     bool canSubmitRequest();
 
     bool enabled() const;
+
+    // Wait for the network loading in the background, rethrowing its error.
+    // Called on first use, returns at once afterwards.
+    void waitLoaded();
 };
 
 class Load {
@@ -121,15 +204,42 @@ class Load {
 	BaseDetection& detector;
     explicit Load(BaseDetection& detector) : detector(detector) { }
 
-    void into(InferenceEngine::Core & plg, std::string& deviceName, bool enable_dynamic_batch = false) const {
+    // With a cache the network is imported from it when it was compiled before.
+    // deviceLock, when given, is held while the network is compiled or imported.
+    void into(InferenceEngine::Core & plg, std::string& deviceName, bool enable_dynamic_batch = false, NetworkCache *cache = nullptr,
+              std::mutex *deviceLock = nullptr) const {
         if (detector.enabled()) {
-            std::map<std::string, std::string> config;
-            // if specified, enable Dynamic Batching
-            if (enable_dynamic_batch) {
+            std::map<std::string, std::string> config = detector.pluginConfig;
+            // if specified, enable Dynamic Batching, pointless without batches
+            detector.dynamicBatch = enable_dynamic_batch && detector.maxBatch > 1;
+            if (detector.dynamicBatch) {
                 config[InferenceEngine::PluginConfigParams::KEY_DYN_BATCH_ENABLED] = InferenceEngine::PluginConfigParams::YES;
             }
-            detector.net = plg.LoadNetwork(detector.read(), deviceName, config);
+            InferenceEngine::CNNNetwork network = detector.read();
+            detector.precision = IRPrecision(detector.commandLineFlag);
+            BOOST_LOG_TRIVIAL(info) << detector.topoName << ": " << detector.precision << " model";
+            if (detector.precision == "INT8" && deviceName.find("CPU") == std::string::npos) {
+                // Only the CPU plugin runs the quantized layers as integers, the others fall back to floats
+                BOOST_LOG_TRIVIAL(warning) << detector.topoName << ": INT8 models only run faster on CPU, not on " << deviceName;
+            }
+            std::unique_lock<std::mutex> lock;
+            if (deviceLock != nullptr) {
+                lock = std::unique_lock<std::mutex>(*deviceLock);
+            }
+            detector.net = cache != nullptr ? cache->load(plg, network, detector.commandLineFlag, deviceName, config)
+                                            : plg.LoadNetwork(network, deviceName, config);
             detector.plugin = &plg;
+            if (lock.owns_lock()) {
+                lock.unlock();
+            }
+            // What the plugin made of the keys asked for
+            for (auto && key : detector.pluginConfig) {
+                try {
+                    BOOST_LOG_TRIVIAL(info) << detector.topoName << ": " << key.first << " = " << detector.net.GetConfig(key.first).as<std::string>();
+                } catch (const std::exception &error) {
+                    BOOST_LOG_TRIVIAL(warning) << detector.topoName << ": " << key.first << " is not reported by " << deviceName << ": " << error.what();
+                }
+            }
         }
     }
 };
@@ -0,0 +1,111 @@
+#include "bench_report.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+static std::string quote(const std::string &text)
+{
+    std::ostringstream out;
+    out << '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+            } else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+void BenchReport::write(std::ostream &out) const
+{
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"config\": {\n";
+    out << "    \"loops\": " << this -> loops << ",\n";
+    out << "    \"async_depth\": " << this -> asyncDepth << ",\n";
+    out << "    \"auto_tune\": " << (this -> autoTune ? "true" : "false") << ",\n";
+    if (this -> autoTune) {
+        out << "    \"tuned_async_depth\": " << this -> tunedDepth << ",\n";
+        out << "    \"tuned_batch\": " << this -> tunedBatch << ",\n";
+    }
+    out << "    \"detection_interval\": " << this -> detectionInterval << ",\n";
+    out << "    \"models\": [";
+    for (size_t m = 0; m < this -> models.size(); m++) {
+        const BenchModel &model = this -> models[m];
+        out << (m ? ",\n" : "\n") << "      {\"name\": " << quote(model.name) << ", \"model\": " << quote(model.model)
+            << ", \"device\": " << quote(model.device) << ", \"batch\": " << model.batch
+            << ", \"precision\": " << quote(model.precision) << "}";
+    }
+    out << "\n    ]\n";
+    out << "  },\n";
+
+    out << "  \"frames\": " << this -> frames << ",\n";
+    out << "  \"startup_ms\": " << this -> startupMs << ",\n";
+    out << "  \"first_detection_ms\": " << this -> firstDetectionMs << ",\n";
+    out << "  \"wallclock_ms\": " << this -> wallclockMs << ",\n";
+    out << "  \"fps\": " << (this -> wallclockMs > 0 ? 1000.0 * this -> frames / this -> wallclockMs : 0.0) << ",\n";
+
+    out << "  \"streams\": [";
+    for (size_t s = 0; s < this -> streams.size(); s++) {
+        const BenchStream &stream = this -> streams[s];
+        out << (s ? ",\n" : "\n") << "    {\"source\": " << quote(stream.source) << ", \"frames_decoded\": " << stream.decoded
+            << ", \"frames_dropped\": " << stream.dropped << ", \"latency_mean_ms\": " << stream.latencyMeanMs
+            << ", \"latency_max_ms\": " << stream.latencyMaxMs << "}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"stages\": {";
+    bool first = true;
+    for (int s = 0; this -> stats != nullptr && s < PipelineStats::STAGES; s++) {
+        const LatencyHistogram &histogram = this -> stats -> stages[s];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n") << "    " << quote(PipelineStats::name(static_cast<PipelineStats::Stage>(s)))
+            << ": {\"samples\": " << histogram.count() << ", \"mean_ms\": " << histogram.meanMs()
+            << ", \"p50_ms\": " << histogram.percentileMs(0.50) << ", \"p90_ms\": " << histogram.percentileMs(0.90)
+            << ", \"p99_ms\": " << histogram.percentileMs(0.99) << ", \"max_ms\": " << histogram.maxMs() << "}";
+        first = false;
+    }
+    out << "\n  },\n";
+
+    out << "  \"objects\": {";
+    first = true;
+    for (auto && count : this -> objects) {
+        out << (first ? "\n" : ",\n") << "    " << quote(count.first) << ": " << count.second;
+        first = false;
+    }
+    out << "\n  }";
+    if (this -> agreement != nullptr) {
+        const DetectionAgreement &agreement = *this -> agreement;
+        out << ",\n  \"agreement\": {\"reference\": " << quote(agreement.reference)
+            << ", \"reference_precision\": " << quote(agreement.referencePrecision)
+            << ", \"reference_fps\": " << agreement.referenceFps << ", \"frames\": " << agreement.frames
+            << ", \"recall\": " << agreement.recall() << ", \"precision\": " << agreement.precision()
+            << ", \"mean_iou\": " << agreement.meanIoU() << "}";
+    }
+    out << "\n}\n";
+}
+
+void BenchReport::save(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot write the benchmark report to " + path);
+    }
+    this -> write(file);
+    if (!file) {
+        throw std::runtime_error("Cannot write the benchmark report to " + path);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "detection_log.hpp"
+#include "latency_stats.hpp"
+
+// Detection network of a benchmark run
+struct BenchModel
+{
+    std::string name;
+    std::string model;
+    std::string device;
+    int batch;
+    std::string precision;      // Of the IR: FP32, FP16 or INT8
+};
+
+// Counters of one input of a benchmark run
+struct BenchStream
+{
+    std::string source;
+    uint64_t decoded;
+    uint64_t dropped;
+    double latencyMeanMs;       // End-to-end, from decode to render
+    double latencyMaxMs;
+};
+
+/* ==========================================================================
+
+Struct : BenchReport
+
+Results and configuration of a -bench run, written as one JSON document so
+runs on different machines, devices and precisions can be compared by
+scripts rather than by reading the logs.
+
+========================================================================== */
+struct BenchReport
+{
+    unsigned loops = 1;                         // Times every input was played
+    int asyncDepth = 1;
+    bool autoTune = false;
+    int tunedDepth = 1;                         // Settings auto-tune ended with
+    int tunedBatch = 1;
+    int detectionInterval = 1;
+    std::vector<BenchModel> models;
+    std::vector<BenchStream> streams;
+    uint64_t frames = 0;
+    double wallclockMs = 0;
+    double startupMs = 0;                       // From the start of the process to the networks loaded
+    double firstDetectionMs = 0;                // From the start of the process to the first detection results
+    std::map<std::string, uint64_t> objects;    // Detections per class, summed over the frames
+    const PipelineStats *stats = nullptr;
+    const DetectionAgreement *agreement = nullptr;  // Against the -det_ref run, if any
+
+    void write(std::ostream &out) const;
+
+    // Write the report to path, throws std::runtime_error if it cannot
+    void save(const std::string &path) const;
+};
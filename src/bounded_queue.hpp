@@ -0,0 +1,161 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <boost/log/trivial.hpp>
+
+/* ==========================================================================
+
+Class : BoundedQueue
+
+Thread-safe FIFO connecting two pipeline stages running on their own
+threads. The capacity is fixed and the backpressure policy is to block:
+push() waits while the queue is full, so a slow consumer throttles its
+producer instead of letting frames pile up. A producer that must not block
+(e.g. one holding a partial batch) uses tryPush() and decides what to do
+when the queue is full. close() ends the stream: pushes fail and pop()
+returns false once the remaining items are drained.
+
+The queue records its depth on every push and the time producers spent
+blocked on a full queue, logged by logStats().
+
+========================================================================== */
+template <typename T>
+class BoundedQueue
+{
+private:
+    typedef std::chrono::high_resolution_clock clock;
+
+    std::string name;
+    size_t limit;
+    std::deque<T> items;
+    bool closed;
+    mutable std::mutex queue_mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    // Depth metrics
+    uint64_t pushes;
+    uint64_t depthSum;
+    size_t maxDepth;
+    uint64_t fullWaits;
+    double fullWaitMs;
+
+    void pushLocked(T &&item) {
+        this -> items.push_back(std::move(item));
+        this -> pushes++;
+        this -> depthSum += this -> items.size();
+        if (this -> items.size() > this -> maxDepth) {
+            this -> maxDepth = this -> items.size();
+        }
+    }
+
+public:
+    BoundedQueue(const std::string &name, size_t capacity)
+        : name(name), limit(capacity > 0 ? capacity : 1), closed(false), pushes(0), depthSum(0), maxDepth(0),
+          fullWaits(0), fullWaitMs(0) {}
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Block while the queue is full. Returns false if the queue was closed.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(this -> queue_mutex);
+        if (this -> items.size() >= this -> limit && !this -> closed) {
+            clock::time_point start = clock::now();
+            this -> not_full.wait(lock, [this] { return this -> closed || this -> items.size() < this -> limit; });
+            this -> fullWaits++;
+            this -> fullWaitMs += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        }
+        if (this -> closed) {
+            return false;
+        }
+        this -> pushLocked(std::move(item));
+        lock.unlock();
+        this -> not_empty.notify_one();
+        return true;
+    }
+
+    // Never blocks. Returns false, leaving item untouched, if the queue is full or closed.
+    bool tryPush(T &item) {
+        {
+            std::lock_guard<std::mutex> lock(this -> queue_mutex);
+            if (this -> closed || this -> items.size() >= this -> limit) {
+                return false;
+            }
+            this -> pushLocked(std::move(item));
+        }
+        this -> not_empty.notify_one();
+        return true;
+    }
+
+    // Block until an item is available. Returns false once closed and drained.
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(this -> queue_mutex);
+        this -> not_empty.wait(lock, [this] { return this -> closed || !this -> items.empty(); });
+        if (this -> items.empty()) {
+            return false;
+        }
+        item = std::move(this -> items.front());
+        this -> items.pop_front();
+        lock.unlock();
+        this -> not_full.notify_one();
+        return true;
+    }
+
+    // Never blocks. Returns false if the queue is empty.
+    bool tryPop(T &item) {
+        {
+            std::lock_guard<std::mutex> lock(this -> queue_mutex);
+            if (this -> items.empty()) {
+                return false;
+            }
+            item = std::move(this -> items.front());
+            this -> items.pop_front();
+        }
+        this -> not_full.notify_one();
+        return true;
+    }
+
+    // No more pushes, consumers drain what is left
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(this -> queue_mutex);
+            this -> closed = true;
+        }
+        this -> not_empty.notify_all();
+        this -> not_full.notify_all();
+    }
+
+    bool isClosed() const {
+        std::lock_guard<std::mutex> lock(this -> queue_mutex);
+        return this -> closed;
+    }
+
+    // Closed and nothing left to pop
+    bool drained() const {
+        std::lock_guard<std::mutex> lock(this -> queue_mutex);
+        return this -> closed && this -> items.empty();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(this -> queue_mutex);
+        return this -> items.size();
+    }
+
+    size_t capacity() const { return this -> limit; }
+
+    void logStats() const {
+        std::lock_guard<std::mutex> lock(this -> queue_mutex);
+        BOOST_LOG_TRIVIAL(info) << "Queue " << this -> name << ": capacity " << this -> limit << ", " << this -> pushes
+                                << " items, depth " << (this -> pushes ? static_cast<double>(this -> depthSum) / this -> pushes : 0.0)
+                                << " on average, " << this -> maxDepth << " at most, producer blocked " << this -> fullWaits
+                                << " times for " << this -> fullWaitMs << " ms";
+    }
+};
@@ -0,0 +1,110 @@
+#include "calibration_set.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <boost/log/trivial.hpp>
+
+// Thumbnails are small enough to compare a frame with hundreds of kept ones
+static const cv::Size thumbnail_size(32, 32);
+// Files are sampled with this many frames per frame wanted, the duplicates are skipped
+static const int oversampling = 4;
+// Candidates read per frame wanted before giving up on an input, a static camera
+// would otherwise only yield duplicates forever
+static const int max_candidates = 4 * oversampling;
+
+static void makeDirectory(const std::string &dir)
+{
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Cannot create the directory " + dir);
+    }
+}
+
+CalibrationSet::CalibrationSet(const std::string &dir, size_t maxFrames, double minDifference)
+    : dir(dir), maxFrames(maxFrames), minDifference(minDifference), duplicates(0)
+{
+    makeDirectory(dir);
+}
+
+void CalibrationSet::addInput(const std::string &name, cv::Size size)
+{
+    makeDirectory(this -> dir + "/" + name);
+    this -> inputs.emplace_back(name, size);
+    BOOST_LOG_TRIVIAL(info) << "Calibration frames for -" << name << " are resized to " << size.width << "x" << size.height;
+}
+
+bool CalibrationSet::add(const cv::Mat &frame, const std::string &tag)
+{
+    if (this -> full()) {
+        return false;
+    }
+    cv::Mat gray;
+    cv::Mat thumbnail;
+    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    cv::resize(gray, gray, thumbnail_size, 0, 0, cv::INTER_AREA);
+    gray.convertTo(thumbnail, CV_32F, 1.0 / 255);
+    cv::Mat difference;
+    for (auto && kept : this -> thumbnails) {
+        cv::absdiff(thumbnail, kept, difference);
+        if (cv::mean(difference)[0] < this -> minDifference) {
+            this -> duplicates++;
+            return false;
+        }
+    }
+    // Resized as the detectors resize their input
+    cv::Mat resized;
+    for (auto && input : this -> inputs) {
+        cv::resize(frame, resized, input.second);
+        const std::string path = this -> dir + "/" + input.first + "/" + tag + ".png";
+        if (!cv::imwrite(path, resized)) {
+            throw std::runtime_error("Cannot write " + path);
+        }
+    }
+    this -> thumbnails.push_back(thumbnail);
+    return true;
+}
+
+void DumpCalibrationSet(const std::vector<std::string> &sources, CalibrationSet &set)
+{
+    for (size_t s = 0; s < sources.size() && !set.full(); s++) {
+        cv::VideoCapture cap;
+        if (!(sources[s] == "cam" ? cap.open(0) : cap.open(sources[s]))) {
+            throw std::invalid_argument("Cannot open input file or camera: " + sources[s]);
+        }
+        // What is left of the set is shared by the inputs left
+        const size_t quota = (set.capacity() - set.kept() + sources.size() - s - 1) / (sources.size() - s);
+        const size_t target = set.kept() + quota;
+        const double frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
+        // Cameras have no length, every frame is a candidate
+        const long stride = frameCount > 0 ? std::max(1L, static_cast<long>(frameCount / (quota * oversampling))) : 1;
+        BOOST_LOG_TRIVIAL(info) << "Sampling one frame out of " << stride << " of " << sources[s];
+        const size_t keptBefore = set.kept();
+        const size_t maxCandidates = quota * max_candidates;
+        size_t candidates = 0;
+        cv::Mat frame;
+        long index = 0;
+        while (set.kept() < target && candidates < maxCandidates) {
+            // Frames in between are only grabbed, not decoded
+            if (index % stride != 0) {
+                if (!cap.grab()) {
+                    break;
+                }
+                index++;
+                continue;
+            }
+            if (!cap.read(frame) || frame.empty()) {
+                break;
+            }
+            set.add(frame, std::to_string(s) + "_" + std::to_string(index));
+            candidates++;
+            index++;
+        }
+        BOOST_LOG_TRIVIAL(info) << "Kept " << set.kept() - keptBefore << " frames of " << sources[s] << " out of " << candidates << " read"
+                                << (set.kept() < target && candidates >= maxCandidates ? ", the others were too alike" : "");
+    }
+    BOOST_LOG_TRIVIAL(info) << "Calibration set of " << set.kept() << " frames, " << set.duplicatesSkipped() << " near duplicates skipped";
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/* ==========================================================================
+
+Class : CalibrationSet
+
+Frames of our own footage to calibrate INT8 models with, written as images
+already resized to the input of every network, in a directory per network.
+A frame is only kept if it differs enough from every frame kept before,
+compared on small grayscale thumbnails, so a static scene does not fill the
+set with copies of itself.
+
+DumpCalibrationSet() reads the inputs and fills the set, spreading the
+frames over the whole length of the files.
+
+========================================================================== */
+class CalibrationSet
+{
+private:
+    std::string dir;
+    size_t maxFrames;
+    double minDifference;                           // Mean absolute difference of the thumbnails, 0 to 1
+    std::vector<std::pair<std::string, cv::Size>> inputs;
+    std::vector<cv::Mat> thumbnails;                // Of the frames kept
+    uint64_t duplicates;
+
+public:
+    // dir is created if it does not exist, throws std::runtime_error if it cannot
+    CalibrationSet(const std::string &dir, size_t maxFrames, double minDifference);
+
+    // Write the frames kept resized to size, in dir/name
+    void addInput(const std::string &name, cv::Size size);
+
+    // Keep frame, saved as tag.png, unless it looks like a frame kept before.
+    // Returns true when it was kept.
+    bool add(const cv::Mat &frame, const std::string &tag);
+
+    bool full() const { return this -> thumbnails.size() >= this -> maxFrames; }
+    size_t capacity() const { return this -> maxFrames; }
+    size_t kept() const { return this -> thumbnails.size(); }
+    uint64_t duplicatesSkipped() const { return this -> duplicates; }
+};
+
+// Fill set with frames of sources, cameras ("cam") included, sharing it evenly between them.
+// An input is left after 16 frames read per frame wanted, even if too few differed enough.
+void DumpCalibrationSet(const std::vector<std::string> &sources, CalibrationSet &set);
@@ -0,0 +1,118 @@
+#include "cpu_budget.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <boost/log/trivial.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+// Context switches of the whole process so far, voluntary and involuntary
+static void contextSwitches(uint64_t &voluntary, uint64_t &involuntary)
+{
+    voluntary = 0;
+    involuntary = 0;
+#ifdef __linux__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        voluntary = static_cast<uint64_t>(usage.ru_nvcsw);
+        involuntary = static_cast<uint64_t>(usage.ru_nivcsw);
+    }
+#endif
+}
+
+CpuBudget::CpuBudget(unsigned cores, unsigned streams, unsigned trackingThreads, bool pin)
+    : pin(pin), started(std::chrono::steady_clock::now())
+{
+    const unsigned available = std::max(std::thread::hardware_concurrency(), 1u);
+    this -> total = cores > 0 ? std::min(cores, available) : available;
+    this -> io = std::max(1u, std::min(streams + 1, this -> total / 4));
+    const unsigned left = this -> total > this -> io ? this -> total - this -> io : 1;
+    this -> tracking = trackingThreads > 0 ? trackingThreads : std::max(1u, std::min(4u, left / 4));
+    this -> inference = left > this -> tracking ? left - this -> tracking : 1;
+    contextSwitches(this -> startVoluntary, this -> startInvoluntary);
+}
+
+unsigned CpuBudget::inferenceThreadsPerNetwork(unsigned networks, unsigned reserved) const
+{
+    const unsigned left = this -> inference > reserved ? this -> inference - reserved : 0;
+    return std::max(1u, left / std::max(networks, 1u));
+}
+
+unsigned CpuBudget::autoStreams(unsigned threads, unsigned requests)
+{
+    return std::max(1u, std::min(requests, threads / 2));
+}
+
+void CpuBudget::pinCurrentThread(Role role, unsigned index) const
+{
+    if (!this -> pin) {
+        return;
+    }
+#ifdef __linux__
+    unsigned first = 0;
+    unsigned count = this -> inference;
+    if (role == Tracking) {
+        first = this -> inference;
+        count = this -> tracking;
+    } else if (role == Io) {
+        first = this -> inference + this -> tracking;
+        count = this -> total > first ? this -> total - first : 0;
+    }
+    if (first + count > this -> total || count == 0) {
+        // Oversubscribed on purpose (more threads asked than cores), leave it to the scheduler
+        return;
+    }
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    if (role == Tracking) {
+        // One core per tracking thread
+        CPU_SET(first + index % count, &cores);
+    } else {
+        for (unsigned core = first; core < first + count; core++) {
+            CPU_SET(core, &cores);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) != 0) {
+        BOOST_LOG_TRIVIAL(warning) << "Could not pin a thread to cores " << first << "-" << first + count - 1;
+    }
+#else
+    BOOST_LOG_TRIVIAL(warning) << "Thread pinning is only supported on Linux";
+#endif
+}
+
+void CpuBudget::log() const
+{
+    BOOST_LOG_TRIVIAL(info) << "CPU budget: " << this -> total << " cores, " << this -> inference << " inference threads, "
+                            << this -> tracking << " tracking threads, " << this -> io << " cores for I/O"
+                            << (this -> pin ? ", threads pinned" : "");
+}
+
+void CpuBudget::reportContention() const
+{
+    uint64_t voluntary;
+    uint64_t involuntary;
+    contextSwitches(voluntary, involuntary);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this -> started).count();
+    std::string runnable = "unknown";
+#ifdef __linux__
+    // Fourth field of /proc/loadavg: runnable/total scheduling entities
+    std::ifstream loadavg("/proc/loadavg");
+    std::string field;
+    for (int i = 0; i < 4 && loadavg >> field; i++) {
+    }
+    if (loadavg) {
+        runnable = field.substr(0, field.find('/'));
+    }
+#endif
+    BOOST_LOG_TRIVIAL(info) << "CPU contention: " << (involuntary - this -> startInvoluntary) / std::max(seconds, 1e-3)
+                            << " involuntary and " << (voluntary - this -> startVoluntary) / std::max(seconds, 1e-3)
+                            << " voluntary context switches per second, " << runnable << " runnable threads on "
+                            << std::thread::hardware_concurrency() << " cores at exit";
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/* ==========================================================================
+
+Class : CpuBudget
+
+Shares the cores of the machine between the inference engine, the tracking
+pool and the I/O threads (decoders, pipeline stages, database writes), so
+they stop competing for the same cores:
+  - I/O gets one core per stream plus one, at most a quarter of the cores;
+  - tracking gets the requested threads, or a quarter of what is left, 1 to 4;
+  - the CPU plugin gets the rest, split between the networks it runs.
+When pinning, the cores are laid out in that order from core 0, inference
+first: [0, inference) [.., +tracking) [.., total). The CPU plugin
+binds its threads itself starting from core 0, the tracking pool and the
+pipeline threads pin themselves with pinCurrentThread().
+
+reportContention() logs the involuntary context switches of the process,
+i.e. how often a runnable thread was preempted, and the run queue length
+of the machine, the signs of oversubscription.
+
+========================================================================== */
+class CpuBudget
+{
+public:
+    enum Role { Inference, Tracking, Io };
+
+private:
+    unsigned total;
+    unsigned io;
+    unsigned tracking;
+    unsigned inference;
+    bool pin;
+    std::chrono::steady_clock::time_point started;
+    uint64_t startInvoluntary;
+    uint64_t startVoluntary;
+
+public:
+    // cores = 0 uses every core, trackingThreads = 0 picks the tracking pool size
+    CpuBudget(unsigned cores, unsigned streams, unsigned trackingThreads, bool pin);
+
+    unsigned cores() const { return this -> total; }
+    unsigned ioCores() const { return this -> io; }
+    unsigned trackingThreads() const { return this -> tracking; }
+    unsigned inferenceThreads() const { return this -> inference; }
+    // Threads for each of networks networks sharing the CPU plugin, once
+    // reserved threads were given to the networks with a thread count of their own
+    unsigned inferenceThreadsPerNetwork(unsigned networks, unsigned reserved = 0) const;
+    // Streams worth running for a network of threads threads fed by requests
+    // infer requests at once: no more than requests, at least 2 threads each
+    static unsigned autoStreams(unsigned threads, unsigned requests);
+    bool pinning() const { return this -> pin; }
+
+    // Pin the calling thread to the cores of role, index tells threads of the
+    // same role apart. Does nothing unless pinning.
+    void pinCurrentThread(Role role, unsigned index = 0) const;
+
+    void log() const;
+    void reportContention() const;
+};
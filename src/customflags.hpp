@@ -32,7 +32,7 @@
 static const char help_message[] = "Print a usage message.";
 
 /// @brief message for images argument
-static const char video_message[] = "Optional. Path to an video file. Default value is \"cam\" to work with camera.";
+static const char video_message[] = "Optional. Path to an video file, or a comma-separated list of files/cameras processed as separate streams. Default value is \"cam\" to work with camera.";
 
 /// @brief message for model argument
 static const char vehicle_detection_model_message[] = "Optional. Path to the Vehicle (.xml) file.";
@@ -51,6 +51,9 @@ static const char target_device_message_pedestrians[] = "Specify the target devi
 static const char target_device_message_yolo[] = "Specify the target device for YOLO v3 model (CPU, GPU, FPGA, MYRIAD, or HETERO). ";
 static const char target_device_message_vp[] = "Specify the target device for Vehicle and Pedestrian model (CPU, GPU, FPGA, MYRIAD, or HETERO). ";
 
+/// @brief message for number of simultaneously processed frames for Yolo Detection
+static const char num_batch_yolo_message[] = "Specify number of maximum simultaneously processed frames for Yolo Detection, and for the frames read per batch when it runs without -m and -m_p ( default is 1).";
+
 /// @brief message for number of simultaneously vehicle attributes detections using dynamic batch
 static const char num_batch_va_message[] = "Specify number of maximum simultaneously processed vehicles for Vehicle Attributes Detection ( default is 1).";
 
@@ -78,6 +81,121 @@ static const char raw_output_message[] = "Output Inference results as raw values
 /// @brief message async function flag
 static const char async_depth_message[] = "Maximum number of outstanding async API calls allowed (1=synchronous=default, >1=asynchronous).";
 
+/// @brief message for decode ring size
+static const char decode_ring_message[] = "Number of decoded frames buffered ahead of inference by the decode thread (default is 8).";
+
+/// @brief message for detection interval
+static const char det_interval_message[] = "Run detection every <num> frames and only track objects in between, requires -tracking (default is 1, every frame). "
+                                           "With -target_fps it is the largest interval allowed.";
+
+/// @brief message for target output FPS
+static const char target_fps_message[] = "Output FPS to hold by adapting the detection interval at runtime (default is 0, fixed interval).";
+
+/// @brief message for motion gate threshold
+static const char motion_threshold_message[] = "Fraction of changed pixels below which a frame is considered static and the last detections are reused (default is 0, disabled).";
+
+/// @brief message for motion gate refresh interval
+static const char motion_refresh_message[] = "Maximum number of static frames between two detections when -motion_t is set (default is 30).";
+
+/// @brief message for offline segments
+static const char segments_message[] = "Process the input file offline, split into <num> segments run in parallel (default is 0, live processing). Requires -tracking.";
+
+/// @brief message for offline segment overlap
+static const char overlap_message[] = "Overlap in seconds between two consecutive offline segments, used to join their tracks (default is 3).";
+
+/// @brief message for offline output
+static const char offline_out_message[] = "Prefix of the CSV files written by the offline processing (default is offline).";
+
+/// @brief message for live mode
+static const char live_message[] = "Live mode: always process the newest frame and drop the frames the pipeline could not keep up with.";
+
+/// @brief message for the maximum frame age
+static const char max_age_message[] = "Maximum age in ms of a frame entering the pipeline in live mode, older frames are dropped (default is 0, no limit).";
+
+/// @brief message for runtime auto-tuning
+static const char auto_tune_message[] = "Tune the number of infer requests and the batch size at runtime for the best throughput under -max_latency. -n_async and the batch sizes are the upper limits.";
+
+/// @brief message for latency ceiling
+static const char max_latency_message[] = "End-to-end latency ceiling in ms for -auto_tune (default is 200).";
+
+/// @brief message for stats period
+static const char stats_period_message[] = "Log the p50/p90/p99/max latency of every pipeline stage every <num> seconds, 0 only logs them at exit (default is 10).";
+
+/// @brief message for bench
+static const char bench_message[] = "Benchmark mode: no window and no key presses, the results and the pipeline configuration are written as JSON to -bench_out.";
+
+/// @brief message for bench loops
+static const char bench_loops_message[] = "Play the input <num> times in a row in -bench mode (default is 1).";
+
+/// @brief message for bench out
+static const char bench_out_message[] = "File the -bench report is written to (default is bench_report.json).";
+
+/// @brief message for display rate
+static const char display_fps_message[] = "Refresh rate of the result windows, shown by a thread of their own whatever the processing rate (default is 30).";
+
+/// @brief message for display scale
+static const char display_scale_message[] = "Scale of the frames shown in the result windows, below 1 to downscale them (default is 1).";
+
+/// @brief message for batch deadline
+static const char batch_deadline_message[] = "Submit a partial batch once its first frame waited <num> ms for the batch to fill up. SSD detectors on CPU or GPU then only infer the frames in the batch (default is 0, batches are only cut short when the pipeline is full).";
+
+/// @brief message for cpu cores
+static const char cpu_cores_message[] = "Cores shared by inference, tracking and I/O threads (default is 0, every core). Tracking and I/O get their share first, the CPU plugin gets the rest, split between the networks it runs.";
+
+/// @brief message for tracking threads
+static const char tracking_threads_message[] = "Threads tracking the objects of every stream (default is 0, a quarter of the cores left by I/O, 1 to 4).";
+
+/// @brief message for pin threads
+static const char pin_threads_message[] = "Pin inference, tracking and I/O threads to their own cores.";
+
+/// @brief message for number of CPU streams
+static const char nstreams_message[] = "CPU execution streams of Vehicle Detection, each running infer requests on its own threads. auto derives them from -n_async and the threads of the network (default is empty, the plugin default).";
+
+/// @brief message for number of CPU streams for pedestrians
+static const char nstreams_p_message[] = "Same as -nstreams for Pedestrians Detection.";
+
+/// @brief message for number of CPU streams for yolo
+static const char nstreams_y_message[] = "Same as -nstreams for Yolo Detection.";
+
+/// @brief message for number of CPU streams for vehicles and pedestrians
+static const char nstreams_vp_message[] = "Same as -nstreams for Vehicle and Pedestrian Detection.";
+
+/// @brief message for number of CPU threads
+static const char nthreads_message[] = "CPU threads of Vehicle Detection (default is 0, an even share of the inference threads left by the other networks).";
+
+/// @brief message for number of CPU threads for pedestrians
+static const char nthreads_p_message[] = "Same as -nthreads for Pedestrians Detection.";
+
+/// @brief message for number of CPU threads for yolo
+static const char nthreads_y_message[] = "Same as -nthreads for Yolo Detection.";
+
+/// @brief message for number of CPU threads for vehicles and pedestrians
+static const char nthreads_vp_message[] = "Same as -nthreads for Vehicle and Pedestrian Detection.";
+
+/// @brief message for CPU thread binding
+static const char cpu_bind_message[] = "How the CPU plugin binds its threads to cores (default is empty, YES with -pin_threads when a single network runs on the CPU and NO otherwise).";
+
+/// @brief message for compiled network cache
+static const char cache_dir_message[] = "Directory caching the networks compiled for each device, later starts import them instead of compiling them again (default is empty, no cache).";
+
+/// @brief message for lazy loading of the optional networks
+static const char lazy_load_message[] = "Load the optional networks, YOLO (-m_y) and -m_vp, when their first frames arrive instead of at start, so the other networks are ready sooner.";
+
+/// @brief message for calibration set directory
+static const char calib_out_message[] = "Write a calibration set for INT8 quantization to <path> and exit: frames of the inputs, near duplicates skipped, resized to the input of every network given, one directory per network.";
+
+/// @brief message for calibration set size
+static const char calib_frames_message[] = "Frames of the -calib_out calibration set (default is 300).";
+
+/// @brief message for calibration duplicate threshold
+static const char calib_diff_message[] = "Mean difference, between 0 and 1, a frame needs with every frame of the calibration set to join it (default is 0.03).";
+
+/// @brief message for detections output
+static const char det_out_message[] = "Write the detections of every frame and the frame rate to <path>, to compare other runs with it using -det_ref.";
+
+/// @brief message for reference detections
+static const char det_ref_message[] = "Compare the detections with the ones a reference run, e.g. with FP32 models, wrote with -det_out: recall, precision and mean IoU of the boxes, and both frame rates are logged and added to the -bench report.";
+
 /// @brief message no wait for keypress after input stream completed
 static const char no_wait_for_keypress_message[] = "No wait for key press in the end.";
 
@@ -147,6 +265,158 @@ DEFINE_bool(no_show, false, no_show_processed_video);
 /// It is an optional parameter
 DEFINE_uint32(n_async, 1, async_depth_message);
 
+/// \brief parameter to set the number of frames decoded ahead by the decode thread <br>
+/// It is an optional parameter
+DEFINE_uint32(n_ring, 8, decode_ring_message);
+
+/// \brief parameter to set the number of frames between two detections <br>
+/// It is an optional parameter
+DEFINE_uint32(det_interval, 1, det_interval_message);
+
+/// \brief parameter to set the output FPS the detection interval adapts to <br>
+/// It is an optional parameter
+DEFINE_double(target_fps, 0, target_fps_message);
+
+/// \brief parameter to set the fraction of changed pixels that counts as motion <br>
+/// It is an optional parameter
+DEFINE_double(motion_t, 0, motion_threshold_message);
+
+/// \brief parameter to set the maximum number of frames the last detections are reused <br>
+/// It is an optional parameter
+DEFINE_uint32(motion_refresh, 30, motion_refresh_message);
+
+/// \brief parameter to process a file offline in parallel segments <br>
+/// It is an optional parameter
+DEFINE_uint32(segments, 0, segments_message);
+
+/// \brief parameter to set the overlap of the offline segments <br>
+/// It is an optional parameter
+DEFINE_double(overlap, 3, overlap_message);
+
+/// \brief parameter to set the prefix of the offline results <br>
+/// It is an optional parameter
+DEFINE_string(offline_out, "offline", offline_out_message);
+
+/// \brief parameter to process the newest frame of live inputs <br>
+/// It is an optional parameter
+DEFINE_bool(live, false, live_message);
+
+/// \brief parameter to set the maximum age of live frames <br>
+/// It is an optional parameter
+DEFINE_uint32(max_age, 0, max_age_message);
+
+/// \brief parameter to tune the async depth and batch size at runtime <br>
+/// It is an optional parameter
+DEFINE_bool(auto_tune, false, auto_tune_message);
+
+/// \brief parameter to set the latency ceiling of the auto-tuning <br>
+/// It is an optional parameter
+DEFINE_double(max_latency, 200, max_latency_message);
+
+/// \brief Period of the stage latency report in seconds <br>
+/// It is an optional parameter
+DEFINE_uint32(stats_period, 10, stats_period_message);
+
+/// \brief Headless benchmark run with a JSON report <br>
+/// It is an optional parameter
+DEFINE_bool(bench, false, bench_message);
+
+/// \brief Number of times the input is played in -bench mode <br>
+/// It is an optional parameter
+DEFINE_uint32(bench_loops, 1, bench_loops_message);
+
+/// \brief Path of the benchmark report <br>
+/// It is an optional parameter
+DEFINE_string(bench_out, "bench_report.json", bench_out_message);
+
+/// \brief Refresh rate of the display thread <br>
+/// It is an optional parameter
+DEFINE_double(display_fps, 30, display_fps_message);
+
+/// \brief Scale of the displayed frames <br>
+/// It is an optional parameter
+DEFINE_double(display_scale, 1, display_scale_message);
+
+/// \brief Maximum time in ms a frame waits for its batch to fill up <br>
+/// It is an optional parameter
+DEFINE_uint32(batch_deadline, 0, batch_deadline_message);
+
+/// \brief Define cores used <br>
+/// It is an optional parameter
+DEFINE_uint32(cpu_cores, 0, cpu_cores_message);
+
+/// \brief Define tracking threads <br>
+/// It is an optional parameter
+DEFINE_uint32(tracking_threads, 0, tracking_threads_message);
+
+/// \brief Enable thread pinning <br>
+/// It is an optional parameter
+DEFINE_bool(pin_threads, false, pin_threads_message);
+
+/// \brief Define CPU streams for Vehicle Detection <br>
+/// It is an optional parameter
+DEFINE_string(nstreams, "", nstreams_message);
+
+/// \brief Define CPU streams for Pedestrians Detection <br>
+/// It is an optional parameter
+DEFINE_string(nstreams_p, "", nstreams_p_message);
+
+/// \brief Define CPU streams for Yolo Detection <br>
+/// It is an optional parameter
+DEFINE_string(nstreams_y, "", nstreams_y_message);
+
+/// \brief Define CPU streams for Vehicle and Pedestrian Detection <br>
+/// It is an optional parameter
+DEFINE_string(nstreams_vp, "", nstreams_vp_message);
+
+/// \brief Define CPU threads for Vehicle Detection <br>
+/// It is an optional parameter
+DEFINE_uint32(nthreads, 0, nthreads_message);
+
+/// \brief Define CPU threads for Pedestrians Detection <br>
+/// It is an optional parameter
+DEFINE_uint32(nthreads_p, 0, nthreads_p_message);
+
+/// \brief Define CPU threads for Yolo Detection <br>
+/// It is an optional parameter
+DEFINE_uint32(nthreads_y, 0, nthreads_y_message);
+
+/// \brief Define CPU threads for Vehicle and Pedestrian Detection <br>
+/// It is an optional parameter
+DEFINE_uint32(nthreads_vp, 0, nthreads_vp_message);
+
+/// \brief Define CPU thread binding <br>
+/// It is an optional parameter
+DEFINE_string(cpu_bind, "", cpu_bind_message);
+
+/// \brief Define compiled network cache <br>
+/// It is an optional parameter
+DEFINE_string(cache_dir, "", cache_dir_message);
+
+/// \brief Define lazy loading of the optional networks <br>
+/// It is an optional parameter
+DEFINE_bool(lazy_load, false, lazy_load_message);
+
+/// \brief Define calibration set directory <br>
+/// It is an optional parameter
+DEFINE_string(calib_out, "", calib_out_message);
+
+/// \brief Define calibration set size <br>
+/// It is an optional parameter
+DEFINE_uint32(calib_frames, 300, calib_frames_message);
+
+/// \brief Define calibration duplicate threshold <br>
+/// It is an optional parameter
+DEFINE_double(calib_diff, 0.03, calib_diff_message);
+
+/// \brief Define detections output <br>
+/// It is an optional parameter
+DEFINE_string(det_out, "", det_out_message);
+
+/// \brief Define reference detections <br>
+/// It is an optional parameter
+DEFINE_string(det_ref, "", det_ref_message);
+
 ///
 DEFINE_bool(show_graph, false, show_graph_message);
 DEFINE_bool(show_selection, false, show_interest_areas_selection);
@@ -159,7 +429,7 @@ DEFINE_uint32(n_p, 1, num_batch_message);
 DEFINE_string(d_p, "CPU", target_device_message_pedestrians);
 
 DEFINE_string(m_y, "", yolo_model_message);
-DEFINE_uint32(n_y, 1, num_batch_message);
+DEFINE_uint32(n_y, 1, num_batch_yolo_message);
 DEFINE_string(d_y, "CPU", target_device_message_yolo);
 DEFINE_double(iou_t, 0.4, intersection_over_union_yolo);
 
@@ -189,11 +459,49 @@ static void showUsage() {
     std::cout << "\t-d_p \"<device>\"\t\t\t" << target_device_message_pedestrians << std::endl; // NOSONAR
     std::cout << "\t-n_p \"<num>\"\t\t\t" << num_batch_va_message << std::endl; // NOSONAR
     std::cout << "\t-d_y \"<device>\"\t\t\t" << target_device_message_yolo << std::endl; // NOSONAR
-    std::cout << "\t-n_y \"<num>\"\t\t\t" << num_batch_va_message << std::endl; // NOSONAR
+    std::cout << "\t-n_y \"<num>\"\t\t\t" << num_batch_yolo_message << std::endl; // NOSONAR
     std::cout << "\t-d_vp \"<device>\"\t\t\t" << target_device_message_vp << std::endl; // NOSONAR
     std::cout << "\t-n_vp \"<num>\"\t\t\t" << num_batch_va_message << std::endl; // NOSONAR
     std::cout << "\t-dyn_va\t\t\t\t" << dyn_va_message << std::endl; // NOSONAR
     std::cout << "\t-n_aysnc \"<num>\"\t\t\t" << async_depth_message << std::endl; // NOSONAR
+    std::cout << "\t-n_ring \"<num>\"\t\t\t" << decode_ring_message << std::endl; // NOSONAR
+    std::cout << "\t-det_interval \"<num>\"\t\t" << det_interval_message << std::endl; // NOSONAR
+    std::cout << "\t-target_fps \"<num>\"\t\t" << target_fps_message << std::endl; // NOSONAR
+    std::cout << "\t-motion_t \"<num>\"\t\t\t" << motion_threshold_message << std::endl; // NOSONAR
+    std::cout << "\t-motion_refresh \"<num>\"\t\t" << motion_refresh_message << std::endl; // NOSONAR
+    std::cout << "\t-segments \"<num>\"\t\t\t" << segments_message << std::endl; // NOSONAR
+    std::cout << "\t-overlap \"<num>\"\t\t\t" << overlap_message << std::endl; // NOSONAR
+    std::cout << "\t-offline_out \"<path>\"\t\t" << offline_out_message << std::endl; // NOSONAR
+    std::cout << "\t-live\t\t\t\t\t" << live_message << std::endl; // NOSONAR
+    std::cout << "\t-max_age \"<num>\"\t\t\t" << max_age_message << std::endl; // NOSONAR
+    std::cout << "\t-auto_tune\t\t\t\t" << auto_tune_message << std::endl; // NOSONAR
+    std::cout << "\t-max_latency \"<num>\"\t\t" << max_latency_message << std::endl; // NOSONAR
+    std::cout << "\t-stats_period \"<num>\"\t\t" << stats_period_message << std::endl; // NOSONAR
+    std::cout << "\t-bench\t\t\t\t\t" << bench_message << std::endl; // NOSONAR
+    std::cout << "\t-bench_loops \"<num>\"\t\t" << bench_loops_message << std::endl; // NOSONAR
+    std::cout << "\t-bench_out \"<path>\"\t\t" << bench_out_message << std::endl; // NOSONAR
+    std::cout << "\t-display_fps \"<num>\"\t\t" << display_fps_message << std::endl; // NOSONAR
+    std::cout << "\t-display_scale \"<num>\"\t\t" << display_scale_message << std::endl; // NOSONAR
+    std::cout << "\t-batch_deadline \"<num>\"\t" << batch_deadline_message << std::endl; // NOSONAR
+    std::cout << "\t-cpu_cores \"<num>\"\t\t" << cpu_cores_message << std::endl; // NOSONAR
+    std::cout << "\t-tracking_threads \"<num>\"\t" << tracking_threads_message << std::endl; // NOSONAR
+    std::cout << "\t-pin_threads\t\t\t\t" << pin_threads_message << std::endl; // NOSONAR
+    std::cout << "\t-nstreams \"<num|auto>\"\t\t" << nstreams_message << std::endl; // NOSONAR
+    std::cout << "\t-nstreams_p \"<num|auto>\"\t" << nstreams_p_message << std::endl; // NOSONAR
+    std::cout << "\t-nstreams_y \"<num|auto>\"\t" << nstreams_y_message << std::endl; // NOSONAR
+    std::cout << "\t-nstreams_vp \"<num|auto>\"\t" << nstreams_vp_message << std::endl; // NOSONAR
+    std::cout << "\t-nthreads \"<num>\"\t\t" << nthreads_message << std::endl; // NOSONAR
+    std::cout << "\t-nthreads_p \"<num>\"\t\t" << nthreads_p_message << std::endl; // NOSONAR
+    std::cout << "\t-nthreads_y \"<num>\"\t\t" << nthreads_y_message << std::endl; // NOSONAR
+    std::cout << "\t-nthreads_vp \"<num>\"\t\t" << nthreads_vp_message << std::endl; // NOSONAR
+    std::cout << "\t-cpu_bind \"<YES|NO|NUMA>\"\t" << cpu_bind_message << std::endl; // NOSONAR
+    std::cout << "\t-cache_dir \"<path>\"\t\t" << cache_dir_message << std::endl; // NOSONAR
+    std::cout << "\t-lazy_load\t\t\t\t" << lazy_load_message << std::endl; // NOSONAR
+    std::cout << "\t-calib_out \"<path>\"\t\t" << calib_out_message << std::endl; // NOSONAR
+    std::cout << "\t-calib_frames \"<num>\"\t\t" << calib_frames_message << std::endl; // NOSONAR
+    std::cout << "\t-calib_diff \"<num>\"\t\t" << calib_diff_message << std::endl; // NOSONAR
+    std::cout << "\t-det_out \"<path>\"\t\t" << det_out_message << std::endl; // NOSONAR
+    std::cout << "\t-det_ref \"<path>\"\t\t" << det_ref_message << std::endl; // NOSONAR
     std::cout << "\t-auto_resize\t\t\t\t" << auto_resize_message << std::endl; // NOSONAR
     std::cout << "\t-no_wait\t\t\t\t" << no_wait_for_keypress_message << std::endl; // NOSONAR
     std::cout << "\t-no_show\t\t\t\t" << no_show_processed_video << std::endl; // NOSONAR
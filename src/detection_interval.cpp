@@ -0,0 +1,50 @@
+#include "detection_interval.hpp"
+
+#include <algorithm>
+
+bool DetectionInterval::detect(int &counter) const
+{
+    bool detect = (counter == 0);
+    counter++;
+    if (counter >= static_cast<int>(this -> current.load())) {
+        counter = 0;
+    }
+    return detect;
+}
+
+void DetectionInterval::frameRendered(double detectionLatencyMs, size_t backlog)
+{
+    if (!this -> enabled() || this -> targetFps <= 0) return;
+    clock::time_point now = clock::now();
+    if (this -> windowFrames == 0) {
+        this -> windowStart = now;
+    }
+    if (detectionLatencyMs >= 0) {
+        this -> latencyMs = this -> latencyMs > 0 ? 0.9 * this -> latencyMs + 0.1 * detectionLatencyMs : detectionLatencyMs;
+    }
+    this -> windowFrames++;
+    double elapsedMs = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(now - this -> windowStart).count();
+    if (elapsedMs >= 1000.0) {
+        this -> adapt(1000.0 * (this -> windowFrames - 1) / elapsedMs, backlog);
+        this -> windowFrames = 0;
+    }
+}
+
+void DetectionInterval::adapt(double outputFps, size_t backlog)
+{
+    const double frameBudgetMs = 1000.0 / this -> targetFps;
+    const size_t current = this -> current.load();
+    size_t next = current;
+    if (outputFps < 0.95 * this -> targetFps || backlog > this -> backlogLimit) {
+        next = std::min(current + 1, this -> maxInterval);
+    } else if (current > 1 && outputFps > 1.15 * this -> targetFps &&
+               this -> latencyMs <= (current - 1) * frameBudgetMs) {
+        next = current - 1;
+    }
+    if (next != current) {
+        BOOST_LOG_TRIVIAL(info) << "Detection interval " << current << " -> " << next << " frames (output "
+                                << outputFps << " fps, detection latency " << this -> latencyMs << " ms, backlog "
+                                << backlog << " frames)";
+        this -> current = next;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include <boost/log/trivial.hpp>
+
+/* ==========================================================================
+
+Class : DetectionInterval
+
+Number of frames K between two detections of a stream. Frames in between
+are only followed by the tracking system. With a target output FPS, K is
+re-evaluated about once per second of output: it grows while the output
+falls behind the target or frames pile up in front of the detectors, and
+shrinks again when there is headroom and the detection latency fits into
+the frame budget of the shorter interval. detect() is called from the read
+stage while frameRendered() runs on the render stage.
+
+========================================================================== */
+class DetectionInterval
+{
+private:
+    typedef std::chrono::high_resolution_clock clock;
+
+    size_t maxInterval;
+    double targetFps;
+    size_t backlogLimit;            // Detection backlog considered as falling behind
+    std::atomic<size_t> current;
+    clock::time_point windowStart;
+    size_t windowFrames;
+    double latencyMs;               // Moving average of the detection latency
+
+    void adapt(double outputFps, size_t backlog);
+
+public:
+    // K starts at maxInterval and stays there unless targetFps > 0
+    DetectionInterval(size_t maxInterval, double targetFps, size_t backlogLimit)
+        : maxInterval(maxInterval > 0 ? maxInterval : 1), targetFps(targetFps), backlogLimit(backlogLimit),
+          current(maxInterval > 0 ? maxInterval : 1), windowFrames(0), latencyMs(0) {}
+
+    bool enabled() const { return this -> maxInterval > 1; }
+    size_t interval() const { return this -> current.load(); }
+
+    // True when the next frame of a stream has to go through the detectors.
+    // counter is the stream's number of frames since its last detection.
+    bool detect(int &counter) const;
+
+    // Account for a rendered frame. detectionLatencyMs is the time the frame
+    // spent from read to render, or a negative value for tracker-only frames,
+    // and backlog the number of frames still waiting for detection results.
+    void frameRendered(double detectionLatencyMs, size_t backlog);
+};
@@ -0,0 +1,54 @@
+#include "detection_join.hpp"
+
+#include <stdexcept>
+
+void DetectionJoin::expect(const FramePipelineFifoItem &batch)
+{
+    for (uint64_t seq : batch.batchOfFrameSeqs) {
+        this -> order.push_back(seq);
+        this -> pending[seq];
+    }
+}
+
+void DetectionJoin::add(Lane lane, FramePipelineFifo &results)
+{
+    while (!results.empty()) {
+        FramePipelineFifoItem &item = results.front();
+        auto it = this -> pending.find(item.frameSeq);
+        if (it == this -> pending.end()) {
+            throw std::logic_error("Detection results received for a frame that was not expected");
+        }
+        Pending &entry = it -> second;
+        if (entry.lanes & lane) {
+            throw std::logic_error("Detection results received twice for the same frame");
+        }
+        entry.lanes |= lane;
+        switch (lane) {
+        case Vehicles:
+            entry.frame.vehicles = std::move(item);
+            break;
+        case Pedestrians:
+            entry.frame.pedestrians = std::move(item);
+            break;
+        case General:
+            entry.frame.general = std::move(item);
+            break;
+        }
+        results.pop();
+    }
+}
+
+bool DetectionJoin::pop(DetectedFrame &frame)
+{
+    if (this -> order.empty()) {
+        return false;
+    }
+    auto it = this -> pending.find(this -> order.front());
+    if (it -> second.lanes != this -> enabledLanes) {
+        return false;
+    }
+    frame = std::move(it -> second.frame);
+    this -> pending.erase(it);
+    this -> order.pop_front();
+    return true;
+}
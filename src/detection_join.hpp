@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+
+#include "base_detection.hpp"
+
+/* ==========================================================================
+
+Class : DetectionJoin
+
+Joins the results of the detection lanes fed with the same batches and
+reorders them. Every frame sent to the detectors carries its read order
+sequence number; results are matched on it rather than on queue position,
+so lanes, and infer requests within a lane, may complete in any order.
+Frames come out strictly in the order the batches were announced with
+expect(), once every enabled lane returned its results for them.
+
+========================================================================== */
+class DetectionJoin
+{
+public:
+    enum Lane { Vehicles = 1, Pedestrians = 2, General = 4 };
+
+private:
+    struct Pending
+    {
+        DetectedFrame frame;
+        int lanes = 0;              // Lanes that returned their results
+    };
+
+    int enabledLanes;
+    std::deque<uint64_t> order;     // Frames expected, in the order they have to come out
+    std::map<uint64_t, Pending> pending;
+
+public:
+    DetectionJoin(bool vehiclesAndPedestrians, bool general)
+        : enabledLanes((vehiclesAndPedestrians ? Vehicles | Pedestrians : 0) | (general ? General : 0)) {}
+
+    // Announce a batch fanned out to the lanes
+    void expect(const FramePipelineFifoItem &batch);
+
+    // Take every per-frame result produced by a lane
+    void add(Lane lane, FramePipelineFifo &results);
+
+    // Next expected frame with the results of all lanes, if complete
+    bool pop(DetectedFrame &frame);
+
+    // Frames announced and not handed out yet
+    size_t waiting() const { return this -> order.size(); }
+};
@@ -0,0 +1,110 @@
+#include "detection_log.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+void DetectionLog::add(int stream, uint64_t frame, const Detections &detections)
+{
+    this -> frames[std::make_pair(stream, frame)] = detections;
+}
+
+void DetectionLog::save(const std::string &path) const
+{
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot write the detections to " + path);
+    }
+    out << "# fps " << this -> fps << " precision " << (this -> precision.empty() ? "-" : this -> precision) << "\n";
+    for (auto && frame : this -> frames) {
+        out << frame.first.first << " " << frame.first.second << " " << frame.second.size();
+        for (auto && box : frame.second) {
+            out << " " << box.second << " " << box.first.x << " " << box.first.y << " " << box.first.width << " " << box.first.height;
+        }
+        out << "\n";
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write the detections to " + path);
+    }
+}
+
+DetectionLog DetectionLog::load(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot read the detections of " + path);
+    }
+    DetectionLog log;
+    std::string line;
+    std::string key;
+    if (std::getline(in, line)) {
+        std::istringstream header(line);
+        header >> key >> key >> log.fps >> key >> log.precision;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        int stream;
+        uint64_t frame;
+        size_t count;
+        if (!(fields >> stream >> frame >> count)) {
+            throw std::runtime_error("Malformed line in " + path + ": " + line);
+        }
+        Detections &detections = log.frames[std::make_pair(stream, frame)];
+        for (size_t i = 0; i < count; i++) {
+            cv::Rect box;
+            int label;
+            if (!(fields >> label >> box.x >> box.y >> box.width >> box.height)) {
+                throw std::runtime_error("Malformed line in " + path + ": " + line);
+            }
+            detections.emplace_back(box, label);
+        }
+    }
+    return log;
+}
+
+static double intersectionOverUnion(const cv::Rect &a, const cv::Rect &b)
+{
+    const double intersection = (a & b).area();
+    const double area = a.area() + b.area() - intersection;
+    return area > 0 ? intersection / area : 0;
+}
+
+DetectionAgreement DetectionLog::compare(const DetectionLog &reference, double minIoU) const
+{
+    DetectionAgreement agreement;
+    agreement.referenceFps = reference.fps;
+    agreement.referencePrecision = reference.precision;
+    for (auto && frame : reference.frames) {
+        auto found = this -> frames.find(frame.first);
+        if (found == this -> frames.end()) {
+            continue;
+        }
+        const Detections &expected = frame.second;
+        const Detections &detected = found -> second;
+        agreement.frames++;
+        agreement.referenceBoxes += expected.size();
+        agreement.boxes += detected.size();
+        // Greedy: every reference box takes the best overlapping box left
+        std::vector<bool> taken(detected.size(), false);
+        for (auto && box : expected) {
+            double best = minIoU;
+            int bestIndex = -1;
+            for (size_t i = 0; i < detected.size(); i++) {
+                if (taken[i] || detected[i].second != box.second) {
+                    continue;
+                }
+                const double iou = intersectionOverUnion(box.first, detected[i].first);
+                if (iou >= best) {
+                    best = iou;
+                    bestIndex = static_cast<int>(i);
+                }
+            }
+            if (bestIndex >= 0) {
+                taken[bestIndex] = true;
+                agreement.matched++;
+                agreement.iouSum += best;
+            }
+        }
+    }
+    return agreement;
+}
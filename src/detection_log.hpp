@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// How far the detections of a run are from the ones of a reference run
+struct DetectionAgreement
+{
+    std::string reference;              // File of the reference run
+    std::string referencePrecision;
+    double referenceFps = 0;
+    uint64_t frames = 0;                // Frames detected in both runs
+    uint64_t referenceBoxes = 0;
+    uint64_t boxes = 0;
+    uint64_t matched = 0;               // Boxes of both runs paired with the same label
+    double iouSum = 0;                  // Of the pairs
+
+    double recall() const { return this -> referenceBoxes ? static_cast<double>(this -> matched) / this -> referenceBoxes : 1.0; }
+    double precision() const { return this -> boxes ? static_cast<double>(this -> matched) / this -> boxes : 1.0; }
+    double meanIoU() const { return this -> matched ? this -> iouSum / this -> matched : 0.0; }
+};
+
+/* ==========================================================================
+
+Class : DetectionLog
+
+Detections of every frame of a run that went to the detectors, keyed by
+stream and by the frame's index in its input, so two runs on the same
+files with different models or precisions can be compared frame by frame,
+whatever frames either of them dropped or skipped.
+The file written by save() has the frame rate and model precisions of the
+run on its first line, then one line per frame:
+    <stream> <frame> <boxes> (<label> <x> <y> <width> <height>)...
+
+========================================================================== */
+class DetectionLog
+{
+public:
+    typedef std::vector<std::pair<cv::Rect, int>> Detections;
+
+private:
+    std::map<std::pair<int, uint64_t>, Detections> frames;
+
+public:
+    double fps = 0;
+    std::string precision;
+
+    // Log the detections of frame, its index in the input of stream
+    void add(int stream, uint64_t frame, const Detections &detections);
+
+    // Throw std::runtime_error if path cannot be written or read
+    void save(const std::string &path) const;
+    static DetectionLog load(const std::string &path);
+
+    // Pair the boxes of every frame detected in both runs, same label and at least minIoU
+    DetectionAgreement compare(const DetectionLog &reference, double minIoU) const;
+};
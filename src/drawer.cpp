@@ -58,6 +58,7 @@ void CallBCrop(int event, int x, int y, int flags, void *scn)
 		cv::Mat roi(cv::Size(sceneRef.orig.cols, sceneRef.orig.rows), sceneRef.orig.type(), cv::Scalar(0));
 		cv::rectangle(roi,cv::Point(x2,y2),cv::Point(x1,y1),cv::Scalar(255,255,255),cv::FILLED);
 		sceneRef.mask = roi;
+		sceneRef.crop = cv::boundingRect(std::vector<cv::Point>{cv::Point(x1,y1), cv::Point(x2,y2)}) & cv::Rect(cv::Point(0,0), sceneRef.orig.size());
 		cv::bitwise_and(sceneRef.orig,roi,sceneRef.aux);
 	}
 }
@@ -141,7 +142,9 @@ int CropFrame(const cv::String & winname, RegionsOfInterest *scn) {
 	RegionsOfInterest& sceneRef = *scene;
 	cv::Mat roi(cv::Size(sceneRef.orig.cols, sceneRef.orig.rows), sceneRef.orig.type(), cv::Scalar(0));
 	cv::rectangle(roi,cv::Point(1,1),cv::Point(sceneRef.orig.cols-2,sceneRef.orig.rows-2),cv::Scalar(255,255,255),cv::FILLED);
+	cv::Rect crop(cv::Point(1,1),cv::Point(sceneRef.orig.cols-1,sceneRef.orig.rows-1));
 	sceneRef.mask = roi;
+	sceneRef.crop = crop;
 
 	std::cout<<"Select rectangle to crop image. Click, drag and drop. Press 'F' to continue." << std::endl;
 	while(!finished){
@@ -153,6 +156,7 @@ int CropFrame(const cv::String & winname, RegionsOfInterest *scn) {
 			case 8: // Del
 				sceneRef.aux = sceneRef.orig.clone();
 				sceneRef.mask = roi;
+				sceneRef.crop = crop;
 				break;
 			case 27: // Esc
 				return -1;
@@ -9,6 +9,7 @@ struct RegionsOfInterest {
 	cv::Mat out;
 	int state = 0;
 	cv::Mat mask;
+	cv::Rect crop;
 	std::vector<std::pair<cv::Mat, int>> mask_streets;
 	std::vector<cv::Mat> mask_sidewalks;
 	std::vector<cv::Mat> mask_crosswalks;
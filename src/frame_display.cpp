@@ -0,0 +1,105 @@
+#include "frame_display.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/log/trivial.hpp>
+
+FrameDisplay::FrameDisplay(const std::vector<std::string> &names, double fps, double scale)
+    : windows(names.size()), fps(fps), scale(scale), stopping(false), keys("key presses", 16), framesShown(0), framesSkipped(0)
+{
+    for (size_t w = 0; w < names.size(); w++) {
+        this -> windows[w].name = names[w];
+    }
+}
+
+void FrameDisplay::start()
+{
+    BOOST_LOG_TRIVIAL(info) << "Display thread started at " << this -> fps << " fps";
+    this -> display_thread = std::thread(&FrameDisplay::displayLoop, this);
+}
+
+void FrameDisplay::show(size_t window, const cv::Mat &frame)
+{
+    std::lock_guard<std::mutex> lock(this -> frames_mutex);
+    Window &target = this -> windows[window];
+    if (target.fresh) {
+        this -> framesSkipped++;
+    }
+    // The buffers are allocated once, then reused for every frame
+    if (this -> scale != 1.0) {
+        cv::resize(frame, target.pending, cv::Size(), this -> scale, this -> scale, cv::INTER_AREA);
+    } else {
+        frame.copyTo(target.pending);
+    }
+    target.fresh = true;
+}
+
+void FrameDisplay::displayLoop()
+{
+    typedef std::chrono::steady_clock clock;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / this -> fps));
+    clock::time_point next = clock::now();
+    bool anyWindow = false;
+    while (!this -> stopping) {
+        next += period;
+        for (size_t w = 0; w < this -> windows.size(); w++) {
+            Window &window = this -> windows[w];
+            {
+                std::lock_guard<std::mutex> lock(this -> frames_mutex);
+                if (!window.fresh) {
+                    continue;
+                }
+                cv::swap(window.pending, window.shown);
+                window.fresh = false;
+            }
+            if (!window.created) {
+                cv::namedWindow(window.name);
+                cv::moveWindow(window.name, 10 + 20 * static_cast<int>(w), 10 + 20 * static_cast<int>(w));
+                window.created = true;
+                anyWindow = true;
+            }
+            cv::imshow(window.name, window.shown);
+            this -> framesShown++;
+        }
+        if (!anyWindow) {
+            // Some backends do not wait in waitKey without a window
+            std::this_thread::sleep_until(next);
+            continue;
+        }
+        // waitKey also runs the HighGUI event loop, it fills the rest of the period
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next - clock::now()).count();
+        int key = cv::waitKey(static_cast<int>(std::max<long long>(left, 1)));
+        if (key != -1) {
+            // Keys pressed faster than the pipeline reads them are dropped
+            this -> keys.tryPush(key);
+        }
+        if (clock::now() > next + period) {
+            // Fell behind, do not try to catch up
+            next = clock::now();
+        }
+    }
+    cv::destroyAllWindows();
+}
+
+bool FrameDisplay::pollKey(int &key)
+{
+    return this -> keys.tryPop(key);
+}
+
+bool FrameDisplay::waitKey(int &key)
+{
+    return this -> keys.pop(key);
+}
+
+void FrameDisplay::stop()
+{
+    if (!this -> display_thread.joinable()) {
+        return;
+    }
+    this -> stopping = true;
+    this -> keys.close();
+    this -> display_thread.join();
+    BOOST_LOG_TRIVIAL(info) << "Display showed " << this -> framesShown << " frames, " << this -> framesSkipped
+                            << " annotated frames were replaced by newer ones before being shown";
+}
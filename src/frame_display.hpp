@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "bounded_queue.hpp"
+
+/* ==========================================================================
+
+Class : FrameDisplay
+
+Shows the annotated frames on a thread of its own, so the pipeline never
+waits for HighGUI: show() only copies, or downscales, the frame into the
+window's back buffer and returns. The display thread wakes up at its own
+frame rate, shows the most recent frame of every window and forwards the
+keys pressed to the pipeline through a queue. Frames overwritten before
+the display got to them are simply never shown.
+
+Once started, every HighGUI call must be made from the display thread.
+
+========================================================================== */
+class FrameDisplay
+{
+private:
+    struct Window {
+        std::string name;
+        cv::Mat pending;                // Latest frame, not shown yet
+        cv::Mat shown;                  // Frame on screen
+        bool fresh = false;             // pending holds a new frame
+        bool created = false;
+    };
+
+    std::vector<Window> windows;
+    double fps;
+    double scale;
+    std::mutex frames_mutex;
+    std::atomic<bool> stopping;
+    BoundedQueue<int> keys;
+    uint64_t framesShown;
+    uint64_t framesSkipped;
+    std::thread display_thread;
+
+    void displayLoop();
+
+public:
+    // One window per name, refreshed fps times per second with frames resized by scale
+    FrameDisplay(const std::vector<std::string> &names, double fps, double scale);
+    ~FrameDisplay() { this -> stop(); }
+
+    FrameDisplay(const FrameDisplay &) = delete;
+    FrameDisplay &operator=(const FrameDisplay &) = delete;
+
+    void start();
+
+    // Hand the latest frame of a window to the display, never blocks on the screen
+    void show(size_t window, const cv::Mat &frame);
+
+    // Key pressed since the last call, returns false if none
+    bool pollKey(int &key);
+
+    // Wait for the next key, returns false once the display is stopped
+    bool waitKey(int &key);
+
+    // Close the windows and join the display thread
+    void stop();
+};
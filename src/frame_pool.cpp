@@ -0,0 +1,140 @@
+#include "frame_pool.hpp"
+
+#include <boost/log/trivial.hpp>
+
+void FrameRef::reset()
+{
+    if (this -> slot != nullptr && this -> slot -> refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this -> slot -> owner -> release(this -> slot);
+    }
+    this -> slot = nullptr;
+}
+
+static void invalidateTensors(FrameSlot *slot)
+{
+    std::lock_guard<std::mutex> lock(slot -> tensors_mutex);
+    for (auto && tensor : slot -> tensors) {
+        tensor.valid = false;
+    }
+}
+
+void FrameRef::setRegion(const cv::Rect &region) const
+{
+    if (region != this -> slot -> region) {
+        invalidateTensors(this -> slot);
+    }
+    this -> slot -> region = region;
+}
+
+cv::Mat FrameRef::preprocessed(cv::Size size, bool planar) const
+{
+    std::lock_guard<std::mutex> lock(this -> slot -> tensors_mutex);
+    PreprocessedTensor *tensor = nullptr;
+    for (auto && cached : this -> slot -> tensors) {
+        if (cached.size == size && cached.planar == planar) {
+            if (cached.valid) {
+                this -> slot -> owner -> tensorBuilt(true);
+                return cached.data;
+            }
+            tensor = &cached;
+            break;
+        }
+    }
+    if (tensor == nullptr) {
+        // Only once per shape and slot, the buffers are reused afterwards
+        this -> slot -> tensors.push_back(PreprocessedTensor{size, planar, false, cv::Mat(), cv::Mat()});
+        tensor = &this -> slot -> tensors.back();
+    }
+    const cv::Mat region = this -> image();
+    const int channels = region.channels();
+    cv::Mat resized = region;
+    if (region.size() != size) {
+        cv::resize(region, tensor -> resized, size);
+        resized = tensor -> resized;
+    }
+    tensor -> data.create(1, channels * size.area(), CV_8UC1);
+    if (planar) {
+        std::vector<cv::Mat> planes;
+        for (int c = 0; c < channels; c++) {
+            planes.emplace_back(size, CV_8UC1, tensor -> data.ptr<uchar>() + c * size.area());
+        }
+        cv::split(resized, planes);
+    } else {
+        cv::Mat interleaved(size, CV_8UC(channels), tensor -> data.ptr<uchar>());
+        resized.copyTo(interleaved);
+    }
+    tensor -> valid = true;
+    this -> slot -> owner -> tensorBuilt(false);
+    return tensor -> data;
+}
+
+FramePool::FramePool(size_t capacity, cv::Size size, int type)
+    : size(size), type(type), shutting_down(false), served(0), reallocations(0), tensors_built(0), tensors_reused(0)
+{
+    const size_t bytes = static_cast<size_t>(size.area()) * CV_ELEM_SIZE(type);
+    this -> free_slots.reserve(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        std::unique_ptr<FrameSlot> slot(new FrameSlot());
+        slot -> owner = this;
+        // cv::fastMalloc returns cache-line aligned memory
+        slot -> buffer_clean = static_cast<unsigned char *>(cv::fastMalloc(bytes));
+        this -> bind(slot.get());
+        this -> free_slots.push_back(slot.get());
+        this -> slots.push_back(std::move(slot));
+    }
+    BOOST_LOG_TRIVIAL(info) << "Frame pool of " << capacity << " frames of " << size.width << "x" << size.height;
+}
+
+FramePool::~FramePool()
+{
+    for (auto && slot : this -> slots) {
+        slot -> frame_clean.release();
+        cv::fastFree(slot -> buffer_clean);
+    }
+}
+
+// Point the slot headers back at the pool-owned storage
+void FramePool::bind(FrameSlot *slot)
+{
+    slot -> frame_clean = cv::Mat(this -> size, this -> type, slot -> buffer_clean);
+}
+
+FrameRef FramePool::acquire()
+{
+    std::unique_lock<std::mutex> lock(this -> pool_mutex);
+    this -> available.wait(lock, [this] { return this -> shutting_down || !this -> free_slots.empty(); });
+    if (this -> shutting_down) {
+        return FrameRef();
+    }
+    FrameSlot *slot = this -> free_slots.back();
+    this -> free_slots.pop_back();
+    slot -> refs.store(1, std::memory_order_relaxed);
+    slot -> region = cv::Rect(cv::Point(), slot -> frame_clean.size());
+    invalidateTensors(slot);
+    this -> served++;
+    return FrameRef(slot);
+}
+
+void FramePool::release(FrameSlot *slot)
+{
+    if (slot -> frame_clean.data != slot -> buffer_clean) {
+        if (this -> reallocations++ == 0) {
+            BOOST_LOG_TRIVIAL(warning) << "Frame storage was reallocated outside the frame pool (resolution or type change?)";
+        }
+        this -> bind(slot);
+    }
+    {
+        std::lock_guard<std::mutex> lock(this -> pool_mutex);
+        this -> free_slots.push_back(slot);
+    }
+    this -> available.notify_one();
+}
+
+void FramePool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(this -> pool_mutex);
+        this -> shutting_down = true;
+    }
+    this -> available.notify_all();
+}
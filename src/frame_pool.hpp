@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+class FramePool;
+
+// Region of a frame resized to a network input, kept with the frame so every
+// detector with the same input shape and layout reuses it
+struct PreprocessedTensor
+{
+    cv::Size size;
+    bool planar;                    // NCHW when true, NHWC otherwise
+    bool valid;
+    cv::Mat resized;
+    cv::Mat data;                   // One row of channels * height * width bytes
+};
+
+// One pre-allocated frame of a FramePool. frame_clean receives the decoded
+// picture and region is the part of it fed to the detectors.
+struct FrameSlot
+{
+    cv::Mat frame_clean;
+    unsigned char *buffer_clean = nullptr;
+    cv::Rect region;
+    std::chrono::high_resolution_clock::time_point captured;
+    double pts = 0;                 // Presentation time in the stream, in ms
+    uint64_t position = 0;          // Index of the frame in its input
+    std::vector<PreprocessedTensor> tensors;
+    std::mutex tensors_mutex;
+    std::atomic<int> refs;
+    FramePool *owner = nullptr;
+
+    FrameSlot() : refs(0) {}
+};
+
+/* ==========================================================================
+
+Class : FrameRef
+
+RAII handle to a FrameSlot. Copies share the slot and the slot goes back
+to its pool when the last handle is dropped, so a frame can never be
+overwritten while a pipeline stage still holds it.
+
+========================================================================== */
+class FrameRef
+{
+private:
+    FrameSlot *slot;
+
+public:
+    FrameRef() : slot(nullptr) {}
+    explicit FrameRef(FrameSlot *slot) : slot(slot) {}
+    FrameRef(const FrameRef &other) : slot(other.slot) {
+        if (this -> slot != nullptr) {
+            this -> slot -> refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    FrameRef(FrameRef &&other) noexcept : slot(other.slot) { other.slot = nullptr; }
+    FrameRef &operator=(FrameRef other) {
+        std::swap(this -> slot, other.slot);
+        return *this;
+    }
+    ~FrameRef() { this -> reset(); }
+
+    void reset();
+
+    explicit operator bool() const { return this -> slot != nullptr; }
+
+    // Zero-copy view of the region seen by the detectors
+    cv::Mat image() const { return this -> slot -> frame_clean(this -> slot -> region); }
+    // Decoded frame, used for display
+    cv::Mat &clean() const { return this -> slot -> frame_clean; }
+
+    // Area of the frame fed to the detectors, the whole frame by default
+    const cv::Rect &region() const { return this -> slot -> region; }
+    void setRegion(const cv::Rect &region) const;
+
+    // Region resized to size, as NCHW (planar) or NHWC bytes. Computed by the
+    // first detector asking for this shape and layout, shared by the others
+    // until the region changes or the frame goes back to the pool.
+    cv::Mat preprocessed(cv::Size size, bool planar) const;
+
+    // When the decoder got the frame
+    std::chrono::high_resolution_clock::time_point captureTime() const { return this -> slot -> captured; }
+    void setCaptureTime(std::chrono::high_resolution_clock::time_point captured) const { this -> slot -> captured = captured; }
+
+    // Presentation timestamp reported by the decoder, in ms
+    double pts() const { return this -> slot -> pts; }
+    void setPts(double pts) const { this -> slot -> pts = pts; }
+
+    // Index of the frame in its input, counting the frames dropped or skipped
+    uint64_t position() const { return this -> slot -> position; }
+    void setPosition(uint64_t position) const { this -> slot -> position = position; }
+};
+
+/* ==========================================================================
+
+Class : FramePool
+
+Fixed-capacity pool of pre-allocated, aligned frame buffers. All memory is
+allocated at construction; acquire() blocks until a slot is released.
+Every time a slot comes back with its storage replaced (e.g. the decoder
+reallocated it) the reallocation is counted, so the counter stays at zero in
+steady state. It only covers the frame buffers, not the other heap
+allocations of the pipeline.
+
+========================================================================== */
+class FramePool
+{
+private:
+    std::vector<std::unique_ptr<FrameSlot>> slots;
+    std::vector<FrameSlot *> free_slots;
+    cv::Size size;
+    int type;
+    bool shutting_down;
+    std::mutex pool_mutex;
+    std::condition_variable available;
+    std::atomic<uint64_t> served;
+    std::atomic<uint64_t> reallocations;
+    std::atomic<uint64_t> tensors_built;
+    std::atomic<uint64_t> tensors_reused;
+
+    void bind(FrameSlot *slot);
+
+public:
+    FramePool(size_t capacity, cv::Size size, int type);
+    ~FramePool();
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    // Take a free frame, blocking until one is released. Returns an empty
+    // handle once the pool is shut down.
+    FrameRef acquire();
+
+    // Called by FrameRef when the last handle to a slot is dropped
+    void release(FrameSlot *slot);
+
+    // Called by FrameRef to account for the preprocessing cache
+    void tensorBuilt(bool reused) { (reused ? this -> tensors_reused : this -> tensors_built)++; }
+
+    // Wake up and fail every pending acquire()
+    void shutdown();
+
+    size_t capacity() const { return this -> slots.size(); }
+    uint64_t framesServed() const { return this -> served.load(); }
+    // Frame buffers reallocated after start-up, the other allocations of the pipeline are not counted
+    uint64_t frameBufferReallocations() const { return this -> reallocations.load(); }
+    // Network inputs resized from a frame, and the ones served from the cache instead
+    uint64_t tensorsBuilt() const { return this -> tensors_built.load(); }
+    uint64_t tensorsReused() const { return this -> tensors_reused.load(); }
+};
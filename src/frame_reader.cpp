@@ -0,0 +1,201 @@
+#include "frame_reader.hpp"
+
+#include <stdexcept>
+
+bool FrameReader::open(const std::string &source, int startFrame)
+{
+    if (!(source == "cam" ? this -> cap.open(0) : this -> cap.open(source))) {
+        return false;
+    }
+    if (startFrame > 0 && !this -> cap.set(cv::CAP_PROP_POS_FRAMES, startFrame)) {
+        return false;
+    }
+    this -> start_frame = startFrame;
+    this -> position = startFrame > 0 ? startFrame : 0;
+    if (this -> live) {
+        // Not every backend honours it, the decode loop drains the device anyway
+        this -> cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    }
+    int width = static_cast<int>(this -> cap.get(cv::CAP_PROP_FRAME_WIDTH));
+    int height = static_cast<int>(this -> cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    if (width <= 0 || height <= 0) {
+        // Some backends only know the geometry after decoding a frame
+        if (!this -> cap.read(this -> probe) || this -> probe.empty()) {
+            return false;
+        }
+        width = this -> probe.cols;
+        height = this -> probe.rows;
+    }
+    // Every frame is allocated here, the decode loop writes in place
+    this -> pool.reset(new FramePool(this -> ring.size() + this -> frames_in_flight,
+                                     cv::Size(width, height), CV_8UC3));
+    BOOST_LOG_TRIVIAL(info) << "Decode thread started for " << source << " with a ring of "
+                            << this -> ring.size() << " frames";
+    this -> decode_thread = std::thread(&FrameReader::decodeLoop, this);
+    return true;
+}
+
+void FrameReader::decodeLoop()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this -> ring_mutex);
+            if (this -> live) {
+                // Never block the camera: the oldest frame makes room for the next one
+                if (this -> count == this -> ring.size()) {
+                    this -> dropOldest();
+                }
+            } else {
+                this -> not_full.wait(lock, [this] { return this -> stopping || this -> count < this -> ring.size(); });
+            }
+            if (this -> stopping) {
+                break;
+            }
+        }
+        FrameRef frame = this -> pool -> acquire();
+        if (!frame) {
+            break;
+        }
+        bool ok;
+        if (!this -> probe.empty()) {
+            this -> probe.copyTo(frame.clean());
+            this -> probe.release();
+            ok = true;
+        } else {
+            StageTimer timer(this -> stats, PipelineStats::Decode);
+            ok = this -> cap.read(frame.clean()) && !frame.clean().empty();
+            while (!ok && this -> rewinds > 0 && this -> cap.set(cv::CAP_PROP_POS_FRAMES, this -> start_frame)) {
+                this -> rewinds--;
+                this -> position = this -> start_frame;
+                ok = this -> cap.read(frame.clean()) && !frame.clean().empty();
+            }
+        }
+        if (ok) {
+            frame.setCaptureTime(std::chrono::high_resolution_clock::now());
+            frame.setPts(this -> cap.get(cv::CAP_PROP_POS_MSEC));
+            frame.setPosition(this -> position++);
+            this -> decoded++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(this -> ring_mutex);
+            if (!ok) {
+                this -> eos = true;
+            } else {
+                if (this -> count == this -> ring.size()) {
+                    this -> dropOldest();
+                }
+                this -> ring[this -> tail] = std::move(frame);
+                this -> tail = (this -> tail + 1) % this -> ring.size();
+                this -> count++;
+            }
+        }
+        this -> not_empty.notify_one();
+        if (!ok) {
+            break;
+        }
+    }
+}
+
+bool FrameReader::read(FrameRef &frame)
+{
+    return this -> readFrame(frame, nullptr);
+}
+
+bool FrameReader::read(FrameRef &frame, std::chrono::milliseconds timeout)
+{
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    return this -> readFrame(frame, &deadline);
+}
+
+bool FrameReader::readFrame(FrameRef &frame, const std::chrono::steady_clock::time_point *deadline)
+{
+    frame.reset();
+    {
+        std::unique_lock<std::mutex> lock(this -> ring_mutex);
+        auto ready = [this] { return this -> count > 0 || this -> eos || this -> stopping; };
+        // False when the deadline passed without a frame
+        auto waitForFrame = [&] {
+            if (deadline == nullptr) {
+                this -> not_empty.wait(lock, ready);
+                return true;
+            }
+            return this -> not_empty.wait_until(lock, *deadline, ready);
+        };
+        if (!waitForFrame()) {
+            return true;
+        }
+        if (this -> live) {
+            // Latest frame wins: everything older than the newest frame is stale
+            while (true) {
+                while (this -> count > 1) {
+                    this -> dropOldest();
+                }
+                if (this -> count == 0 || this -> max_age.count() == 0) {
+                    break;
+                }
+                auto age = std::chrono::high_resolution_clock::now() - this -> ring[this -> head].captureTime();
+                if (age <= this -> max_age) {
+                    break;
+                }
+                this -> dropOldest();
+                if (!waitForFrame()) {
+                    return true;
+                }
+            }
+        }
+        if (this -> count == 0) {
+            return false;
+        }
+        frame = std::move(this -> ring[this -> head]);
+        this -> head = (this -> head + 1) % this -> ring.size();
+        this -> count--;
+    }
+    this -> not_full.notify_one();
+    return true;
+}
+
+void FrameReader::setLiveMode(int max_age_ms)
+{
+    if (this -> decode_thread.joinable()) {
+        throw std::logic_error("Live mode must be set before opening the stream");
+    }
+    this -> live = true;
+    this -> max_age = std::chrono::milliseconds(max_age_ms > 0 ? max_age_ms : 0);
+}
+
+void FrameReader::setLoops(unsigned loops)
+{
+    if (this -> decode_thread.joinable()) {
+        throw std::logic_error("Loops must be set before opening the stream");
+    }
+    this -> rewinds = loops > 1 ? loops - 1 : 0;
+}
+
+// Called with ring_mutex held
+void FrameReader::dropOldest()
+{
+    this -> ring[this -> head].reset();
+    this -> head = (this -> head + 1) % this -> ring.size();
+    this -> count--;
+    this -> dropped++;
+}
+
+void FrameReader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(this -> ring_mutex);
+        this -> stopping = true;
+    }
+    if (this -> pool) {
+        this -> pool -> shutdown();
+    }
+    this -> not_full.notify_all();
+    this -> not_empty.notify_all();
+    if (this -> decode_thread.joinable()) {
+        this -> decode_thread.join();
+    }
+    for (auto && frame : this -> ring) {
+        frame.reset();
+    }
+    this -> cap.release();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <boost/log/trivial.hpp>
+#include "frame_pool.hpp"
+#include "latency_stats.hpp"
+
+/* ==========================================================================
+
+Class : FrameReader
+
+Owns the cv::VideoCapture and decodes frames on a dedicated thread into a
+fixed-size single-producer/single-consumer ring. Frames are decoded straight
+into the stream's FramePool, sized for the ring plus every frame the
+pipeline may hold, and the pipeline only pops ready frames, so decode
+overlaps with inference.
+
+In live mode the decoder never waits for the pipeline: it keeps draining
+the camera and overwrites the oldest frame when the ring is full, and
+read() returns the newest frame, dropping the older ones and any frame
+older than the maximum age.
+
+========================================================================== */
+class FrameReader
+{
+private:
+    cv::VideoCapture cap;
+    std::unique_ptr<FramePool> pool;
+    std::vector<FrameRef> ring;     // Decoded frames waiting for the pipeline
+    size_t frames_in_flight;        // Frames the pipeline may hold at once
+    cv::Mat probe;                  // First frame when the geometry had to be probed
+    size_t head;                    // Next slot to hand to the consumer
+    size_t tail;                    // Next slot to be filled by the decoder
+    size_t count;                   // Number of decoded frames waiting in the ring
+    bool eos;                       // Decoder reached the end of the input
+    bool stopping;                  // Decoder was asked to quit
+    bool live;                      // Latest frame wins, stale frames are dropped
+    std::chrono::milliseconds max_age;
+    int start_frame;                // Where open() started, and rewinds go back to
+    unsigned rewinds;               // Times the input is played again at its end
+    uint64_t position;              // Index in the input of the next frame decoded
+    std::atomic<uint64_t> decoded;
+    std::atomic<uint64_t> dropped;
+    PipelineStats *stats;           // Decode latency, when set
+    std::mutex ring_mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::thread decode_thread;
+
+    void decodeLoop();
+    void dropOldest();
+    bool readFrame(FrameRef &frame, const std::chrono::steady_clock::time_point *deadline);
+
+public:
+    FrameReader(size_t capacity, size_t frames_in_flight)
+        : ring(capacity > 0 ? capacity : 1), frames_in_flight(frames_in_flight), head(0), tail(0), count(0), eos(false), stopping(false),
+          live(false), max_age(0), start_frame(0), rewinds(0), position(0), decoded(0), dropped(0), stats(nullptr) {}
+
+    ~FrameReader() { this -> stop(); }
+
+    FrameReader(const FrameReader &) = delete;
+    FrameReader &operator=(const FrameReader &) = delete;
+
+    // Open a camera ("cam"), device or file and start the decode thread.
+    // Files can start at startFrame, as far as the backend can seek.
+    bool open(const std::string &source, int startFrame = 0);
+
+    // Pop the oldest decoded frame, blocking until one is ready.
+    // Returns false at end of stream.
+    bool read(FrameRef &frame);
+
+    // Same as read(), but gives up after timeout: frame is then left empty
+    // and true is returned, as the stream has not ended.
+    bool read(FrameRef &frame, std::chrono::milliseconds timeout);
+
+    // Switch to live mode before open(). max_age_ms = 0 only keeps the newest frame.
+    void setLiveMode(int max_age_ms);
+
+    // Play the input loops times in a row, rewinding at its end. Only
+    // seekable inputs loop, set before open()
+    void setLoops(unsigned loops);
+
+    // Record the decode latency of every frame into stats, set before open()
+    void setStats(PipelineStats *stats) { this -> stats = stats; }
+
+    // Stop decoding and join the decode thread
+    void stop();
+
+    size_t capacity() const { return this -> ring.size(); }
+    uint64_t framesDecoded() const { return this -> decoded.load(); }
+    // Frames never handed to the pipeline in live mode
+    uint64_t framesDropped() const { return this -> dropped.load(); }
+
+    // Frame pool backing this stream, valid once open() succeeded
+    const FramePool &framePool() const { return *this -> pool; }
+};
@@ -0,0 +1,109 @@
+#include "latency_stats.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+
+LatencyHistogram::LatencyHistogram() : total(0), sumUs(0), maxUs(0)
+{
+    for (auto && count : this -> counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucketOf(uint64_t us)
+{
+    if (us < static_cast<uint64_t>(LINEAR_BUCKETS)) {
+        return static_cast<int>(us);
+    }
+    int exponent = 63;
+    while (!(us >> exponent)) {
+        exponent--;
+    }
+    // us >> (exponent - SUB_BUCKET_BITS) is in [16, 32)
+    const int sub = static_cast<int>(us >> (exponent - SUB_BUCKET_BITS)) - (1 << SUB_BUCKET_BITS);
+    return LINEAR_BUCKETS + (exponent - SUB_BUCKET_BITS - 1) * (1 << SUB_BUCKET_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperUs(int bucket)
+{
+    if (bucket < LINEAR_BUCKETS) {
+        return static_cast<uint64_t>(bucket);
+    }
+    const int exponent = (bucket - LINEAR_BUCKETS) / (1 << SUB_BUCKET_BITS) + SUB_BUCKET_BITS + 1;
+    const uint64_t sub = (bucket - LINEAR_BUCKETS) % (1 << SUB_BUCKET_BITS) + (1 << SUB_BUCKET_BITS);
+    return ((sub + 1) << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+void LatencyHistogram::recordUs(uint64_t us)
+{
+    this -> counts[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    this -> total.fetch_add(1, std::memory_order_relaxed);
+    this -> sumUs.fetch_add(us, std::memory_order_relaxed);
+    uint64_t seen = this -> maxUs.load(std::memory_order_relaxed);
+    while (us > seen && !this -> maxUs.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::record(std::chrono::high_resolution_clock::duration elapsed)
+{
+    const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    this -> recordUs(us > 0 ? static_cast<uint64_t>(us) : 0);
+}
+
+double LatencyHistogram::meanMs() const
+{
+    const uint64_t samples = this -> count();
+    return samples ? this -> sumUs.load(std::memory_order_relaxed) / 1000.0 / samples : 0.0;
+}
+
+double LatencyHistogram::percentileMs(double p) const
+{
+    const uint64_t samples = this -> count();
+    if (samples == 0) {
+        return 0.0;
+    }
+    const uint64_t rank = static_cast<uint64_t>(p * samples + 0.5);
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += this -> counts[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank && seen > 0) {
+            const uint64_t maxUs = this -> maxUs.load(std::memory_order_relaxed);
+            const uint64_t upper = bucketUpperUs(bucket);
+            return (upper < maxUs ? upper : maxUs) / 1000.0;
+        }
+    }
+    return this -> maxMs();
+}
+
+const char *PipelineStats::name(Stage stage)
+{
+    switch (stage) {
+    case Decode: return "decode";
+    case Enqueue: return "preprocess/enqueue";
+    case Infer: return "inference";
+    case Parse: return "fetch results";
+    case Tracking: return "tracking";
+    case Collision: return "collisions";
+    case Database: return "database";
+    case Render: return "render";
+    default: return "unknown";
+    }
+}
+
+void PipelineStats::report(const char *title) const
+{
+    BOOST_LOG_TRIVIAL(info) << title << " (ms)";
+    for (int s = 0; s < STAGES; s++) {
+        const LatencyHistogram &histogram = this -> stages[s];
+        if (histogram.count() == 0) {
+            continue;
+        }
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << std::setw(20) << name(static_cast<Stage>(s)) << ": p50 "
+            << histogram.percentileMs(0.50) << ", p90 " << histogram.percentileMs(0.90) << ", p99 "
+            << histogram.percentileMs(0.99) << ", max " << histogram.maxMs() << " over " << histogram.count() << " samples";
+        BOOST_LOG_TRIVIAL(info) << out.str();
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/* ==========================================================================
+
+Class : LatencyHistogram
+
+Lock-free latency histogram with HDR-style log-linear buckets: values are
+recorded in microseconds, exactly up to 32 us and with 16 buckets per
+power of two above, so percentiles are within about 6% of the real value
+over the whole range. record() is a few relaxed atomic increments and can
+be called from any thread.
+
+========================================================================== */
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int LINEAR_BUCKETS = 2 << SUB_BUCKET_BITS;
+    static const int BUCKETS = LINEAR_BUCKETS + (64 - SUB_BUCKET_BITS - 1) * (1 << SUB_BUCKET_BITS);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sumUs;
+    std::atomic<uint64_t> maxUs;
+
+    static int bucketOf(uint64_t us);
+    static uint64_t bucketUpperUs(int bucket);
+
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void recordUs(uint64_t us);
+    void record(std::chrono::high_resolution_clock::duration elapsed);
+
+    uint64_t count() const { return this -> total.load(std::memory_order_relaxed); }
+    double meanMs() const;
+    double maxMs() const { return this -> maxUs.load(std::memory_order_relaxed) / 1000.0; }
+    // Value below which the fraction p of the samples fall, in ms
+    double percentileMs(double p) const;
+};
+
+/* ==========================================================================
+
+Struct : PipelineStats
+
+One latency histogram per pipeline stage, shared by the threads running
+them. report() logs p50/p90/p99/max of every stage with samples.
+
+========================================================================== */
+struct PipelineStats
+{
+    enum Stage { Decode, Enqueue, Infer, Parse, Tracking, Collision, Database, Render, STAGES };
+
+    std::array<LatencyHistogram, STAGES> stages;
+
+    static const char *name(Stage stage);
+
+    LatencyHistogram &operator[](Stage stage) { return this -> stages[stage]; }
+
+    void report(const char *title) const;
+};
+
+// Records the lifetime of the timer into a stage of stats, if stats is set
+class StageTimer
+{
+private:
+    PipelineStats *stats;
+    PipelineStats::Stage stage;
+    std::chrono::high_resolution_clock::time_point start;
+    bool stopped;
+
+public:
+    StageTimer(PipelineStats *stats, PipelineStats::Stage stage)
+        : stats(stats), stage(stage), start(std::chrono::high_resolution_clock::now()), stopped(false) {}
+
+    ~StageTimer() {
+        if (!this -> stopped) {
+            this -> stop();
+        }
+    }
+
+    // Record the time elapsed until now rather than at the end of the scope, and return it
+    std::chrono::high_resolution_clock::duration stop() {
+        const std::chrono::high_resolution_clock::duration elapsed = std::chrono::high_resolution_clock::now() - this -> start;
+        if (this -> stats != nullptr && !this -> stopped) {
+            (*this -> stats)[this -> stage].record(elapsed);
+        }
+        this -> stopped = true;
+        return elapsed;
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+};
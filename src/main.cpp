@@ -20,7 +20,10 @@
 * \example object_detection_sample_ssd/main.cpp
 */
 #include <gflags/gflags.h>
+#include <atomic>
+#include <exception>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <fstream>
 #include <random>
@@ -29,15 +32,33 @@
 #include <algorithm>
 #include <iterator>
 #include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <queue>
+#include <thread>
 #include <utility>
 #include <stdlib.h>
 
 #include <opencv2/opencv.hpp>
+#include "bench_report.hpp"
+#include "bounded_queue.hpp"
+#include "calibration_set.hpp"
+#include "cpu_budget.hpp"
 #include "customflags.hpp"
 #include "drawer.hpp"
+#include "frame_display.hpp"
+#include "detection_interval.hpp"
+#include "detection_join.hpp"
+#include "detection_log.hpp"
+#include "frame_reader.hpp"
+#include "network_cache.hpp"
+#include "offline_segments.hpp"
+#include "pipeline_events.hpp"
+#include "runtime_tuner.hpp"
+#include "stream_context.hpp"
+#include "thread_pool.hpp"
 
 #include "Tracker.h"
 #include "object_detection.hpp"
@@ -77,9 +98,112 @@ bool ParseAndCheckCommandLine(int argc, char *argv[])
     {
         throw std::invalid_argument("Parameter -n_async must be >= 1");
     }
+    if (FLAGS_motion_t < 0 || FLAGS_motion_t > 1)
+    {
+        throw std::invalid_argument("Parameter -motion_t must be between 0 and 1");
+    }
+    if (FLAGS_motion_refresh < 1)
+    {
+        throw std::invalid_argument("Parameter -motion_refresh must be >= 1");
+    }
+    if (FLAGS_segments > 0 && !FLAGS_tracking)
+    {
+        throw std::invalid_argument("Parameter -segments requires -tracking");
+    }
+    if (FLAGS_segments > 0 && FLAGS_show_selection)
+    {
+        throw std::invalid_argument("Parameter -segments cannot be combined with -show_selection");
+    }
+    if (FLAGS_overlap < 0)
+    {
+        throw std::invalid_argument("Parameter -overlap must be >= 0");
+    }
+    if (FLAGS_det_interval < 1)
+    {
+        throw std::invalid_argument("Parameter -det_interval must be >= 1");
+    }
+    if (FLAGS_det_interval > 1 && !FLAGS_tracking)
+    {
+        throw std::invalid_argument("Parameter -det_interval > 1 requires -tracking");
+    }
+    if (FLAGS_display_fps <= 0)
+    {
+        throw std::invalid_argument("Parameter -display_fps must be > 0");
+    }
+    if (FLAGS_display_scale <= 0)
+    {
+        throw std::invalid_argument("Parameter -display_scale must be > 0");
+    }
+    for (const auto &streams : {std::make_pair("-nstreams", FLAGS_nstreams), std::make_pair("-nstreams_p", FLAGS_nstreams_p),
+                               std::make_pair("-nstreams_y", FLAGS_nstreams_y), std::make_pair("-nstreams_vp", FLAGS_nstreams_vp)})
+    {
+        if (!streams.second.empty() && streams.second != "auto" &&
+            (streams.second.find_first_not_of("0123456789") != std::string::npos || std::stoul(streams.second) == 0))
+        {
+            throw std::invalid_argument(std::string("Parameter ") + streams.first + " must be auto or a number > 0");
+        }
+    }
+    if (!FLAGS_cpu_bind.empty() && FLAGS_cpu_bind != InferenceEngine::PluginConfigParams::YES &&
+        FLAGS_cpu_bind != InferenceEngine::PluginConfigParams::NO && FLAGS_cpu_bind != InferenceEngine::PluginConfigParams::NUMA)
+    {
+        throw std::invalid_argument("Parameter -cpu_bind must be YES, NO or NUMA");
+    }
+    if (!FLAGS_calib_out.empty())
+    {
+        if (FLAGS_segments > 0 || FLAGS_bench)
+        {
+            throw std::invalid_argument("Parameter -calib_out cannot be combined with -segments or -bench");
+        }
+        if (FLAGS_calib_frames < 1)
+        {
+            throw std::invalid_argument("Parameter -calib_frames must be >= 1");
+        }
+        if (FLAGS_calib_diff < 0 || FLAGS_calib_diff > 1)
+        {
+            throw std::invalid_argument("Parameter -calib_diff must be between 0 and 1");
+        }
+    }
+    if ((!FLAGS_det_out.empty() || !FLAGS_det_ref.empty()) && FLAGS_segments > 0)
+    {
+        throw std::invalid_argument("Parameters -det_out and -det_ref cannot be combined with -segments");
+    }
+    if (FLAGS_bench)
+    {
+        if (FLAGS_segments > 0 || FLAGS_show_selection || FLAGS_live)
+        {
+            throw std::invalid_argument("Parameter -bench cannot be combined with -segments, -show_selection or -live");
+        }
+        if (FLAGS_bench_loops < 1)
+        {
+            throw std::invalid_argument("Parameter -bench_loops must be >= 1");
+        }
+        // Nothing may wait for the screen or a key press
+        FLAGS_no_show = true;
+        FLAGS_no_wait = true;
+    }
     return true;
 }
 
+// Split the -i argument into the list of input streams
+std::vector<std::string> ParseInputList(const std::string &list)
+{
+    std::vector<std::string> sources;
+    std::stringstream ss(list);
+    std::string source;
+    while (std::getline(ss, source, ','))
+    {
+        if (!source.empty())
+        {
+            sources.push_back(source);
+        }
+    }
+    if (sources.empty())
+    {
+        throw std::invalid_argument("Parameter -i does not name any input");
+    }
+    return sources;
+}
+
 // Current datetime function
 std::string return_current_time_and_date()
 {
@@ -109,6 +233,8 @@ void init_logging(std::string base)
 // ----------------------------------------------------------------------------------------------------
 int main(int argc, char *argv[])
 {
+    // Startup time is measured from here to the networks being ready
+    const std::chrono::high_resolution_clock::time_point processStart = std::chrono::high_resolution_clock::now();
     try
     {
         // ---------------------------Init Log-------------------------------
@@ -137,16 +263,16 @@ int main(int argc, char *argv[])
         /** This sample covers 2 certain topologies and cannot be generalized **/
         BOOST_LOG_TRIVIAL(info) << "InferenceEngine: " << InferenceEngine::GetInferenceEngineVersion();
 
-        // -----------------------------Read input -----------------------------------------------------
-        BOOST_LOG_TRIVIAL(info) << "Reading input";
-        cv::VideoCapture cap; // Class of OpenCV for video capturing from video files, image sequences or cameras.
-        if (!(FLAGS_i == "cam" ? cap.open(0) : cap.open(FLAGS_i)))
-        { // Open the camera or the file indicated in the argument
-            throw std::invalid_argument("Cannot open input file or camera: " + FLAGS_i);
-        }
-
         // ---------------------Load plugins for inference engine------------------------------------------------
-        std::map<std::string, InferenceEngine::Core> pluginsForDevices;
+        // Plugins are created on their own threads, networks wait for the plugin of their device
+        std::map<std::string, std::unique_ptr<InferenceEngine::Core>> pluginsForDevices;
+        std::map<std::string, std::shared_future<void>> pluginsReady;
+        // Used by the networks loading in the background, which the detectors declared
+        // below wait for when they go away, whatever the way out of main
+        std::unique_ptr<NetworkCache> networkCache;
+        std::map<std::string, std::mutex> deviceLocks;
+        std::atomic<int> networksLoading(0);
+        std::atomic<double> startupMs(0);
         std::vector<std::pair<std::string, std::string>> cmdOptions = {
             {FLAGS_d, FLAGS_m}, {FLAGS_d_p, FLAGS_m_p}, {FLAGS_d_y, FLAGS_m_y}, {FLAGS_d_vp, FLAGS_m_vp}};
 
@@ -178,6 +304,36 @@ int main(int argc, char *argv[])
         const bool yolo_enabled = GeneralDetection.enabled();
         const bool vp_enabled = (VehicleDetection.enabled() && PedestriansDetection.enabled());
         const bool vp2_enabled = VPDetection.enabled();
+        // Frames per batch read for the detectors: set by the SSD lanes when they run, by the general lane otherwise
+        const BaseDetection &generalDetector = vp2_enabled ? static_cast<const BaseDetection &>(VPDetection) : GeneralDetection;
+        const int pipelineBatch = vp_enabled ? VehicleDetection.maxBatch : generalDetector.maxBatch;
+        if ((yolo_enabled || vp2_enabled) && generalDetector.maxBatch < pipelineBatch)
+        {
+            BOOST_LOG_TRIVIAL(warning) << generalDetector.topoName << " takes batches of " << generalDetector.maxBatch << " frames out of "
+                                       << pipelineBatch << ", the other frames get no results from it";
+        }
+
+        // ---------------------Calibration set for INT8 models----------------------------------------------------
+        if (!FLAGS_calib_out.empty())
+        {
+            // Only the IR is read for its input size, nothing is loaded on a device
+            CalibrationSet calibration(FLAGS_calib_out, FLAGS_calib_frames, FLAGS_calib_diff);
+            for (const auto &network : {std::make_pair(static_cast<BaseDetection *>(&VehicleDetection), "m"),
+                                       std::make_pair(static_cast<BaseDetection *>(&PedestriansDetection), "m_p"),
+                                       std::make_pair(static_cast<BaseDetection *>(&GeneralDetection), "m_y"),
+                                       std::make_pair(static_cast<BaseDetection *>(&VPDetection), "m_vp")})
+            {
+                if (!network.first->enabled())
+                {
+                    continue;
+                }
+                const InferenceEngine::InputsDataMap inputs = network.first->read().getInputsInfo();
+                const InferenceEngine::SizeVector dims = inputs.begin()->second->getTensorDesc().getDims();
+                calibration.addInput(network.second, cv::Size(static_cast<int>(dims[3]), static_cast<int>(dims[2])));
+            }
+            DumpCalibrationSet(ParseInputList(FLAGS_i), calibration);
+            return 0;
+        }
 
         for (auto &&option : cmdOptions)
         {
@@ -193,117 +349,321 @@ int main(int argc, char *argv[])
             {
                 continue;
             }
-            BOOST_LOG_TRIVIAL(info) << "Loading plugin " << deviceName;
-            Core core;
-
-            /** Printing plugin version **/
-            std::cout << core.GetVersions(deviceName);
-            /** Load extensions for the CPU plugin **/
-            if (deviceName.find("CPU") != std::string::npos)
-            {
+            // Inserted here, the map is left alone while the plugins are created
+            std::unique_ptr<Core> &plugin = pluginsForDevices[deviceName];
+            pluginsReady[deviceName] = std::async(std::launch::async, [&plugin, deviceName] {
+                BOOST_LOG_TRIVIAL(info) << "Loading plugin " << deviceName;
+                std::unique_ptr<Core> core(new Core());
+
+                /** Printing plugin version **/
+                std::ostringstream versions;
+                versions << core->GetVersions(deviceName);
+                std::cout << versions.str();
+                /** Load extensions for the CPU plugin **/
+                if (deviceName.find("CPU") != std::string::npos)
+                {
 #if (OPENVINO_VER == 2019) // Check if the OpenVino's version is 2019 or other
-                core.AddExtension(std::make_shared<InferenceEngine::Extensions::Cpu::CpuExtensions>(), deviceName);
+                    core->AddExtension(std::make_shared<InferenceEngine::Extensions::Cpu::CpuExtensions>(), deviceName);
 #endif
-                if (!FLAGS_l.empty())
-                {
-                    // CPU(MKLDNN) extensions are loaded as a shared library and passed as a pointer to base extension
+                    if (!FLAGS_l.empty())
+                    {
+                        // CPU(MKLDNN) extensions are loaded as a shared library and passed as a pointer to base extension
 #if (OPENVINO_VER == 2019)
-                    auto extension_ptr = InferenceEngine::make_so_pointer<InferenceEngine::IExtension>(FLAGS_l);
+                        auto extension_ptr = InferenceEngine::make_so_pointer<InferenceEngine::IExtension>(FLAGS_l);
 #else
-                    IExtensionPtr extension_ptr = make_so_pointer<IExtension>(FLAGS_l);
+                        IExtensionPtr extension_ptr = make_so_pointer<IExtension>(FLAGS_l);
 #endif
-                    core.AddExtension(extension_ptr, deviceName);
+                        core->AddExtension(extension_ptr, deviceName);
+                    }
+                }
+                else if (!FLAGS_c.empty())
+                {
+                    // Load Extensions for other plugins not CPU
+                    core->SetConfig({{InferenceEngine::PluginConfigParams::KEY_CONFIG_FILE, FLAGS_c}}, deviceName);
                 }
+                plugin = std::move(core);
+            }).share();
+        }
+
+        // --------------------Load networks (Generated xml/bin files)-------------------------------------------
+        // Partial batches cut by the deadline only pay for their frames with dynamic batching,
+        // which the CPU and GPU plugins support
+        auto dynamicBatch = [](const std::string &deviceName) {
+            return FLAGS_batch_deadline > 0 && !FLAGS_auto_resize &&
+                   (deviceName.find("CPU") != std::string::npos || deviceName.find("GPU") != std::string::npos);
+        };
+        // Cores are shared out before loading, so the CPU plugin only spawns the threads left
+        // to it by tracking and I/O instead of one per core for every network
+        const CpuBudget cpuBudget(FLAGS_cpu_cores, static_cast<unsigned>(ParseInputList(FLAGS_i).size()), FLAGS_tracking_threads, FLAGS_pin_threads);
+        cpuBudget.log();
+        // Threads and streams of every network on the CPU plugin. Networks given their own
+        // thread count get it, the others split the rest of the inference threads
+        struct CpuNetwork
+        {
+            BaseDetection *detector;
+            std::string streams;
+            unsigned threads;
+        };
+        std::vector<CpuNetwork> cpuNetworks;
+        unsigned reservedThreads = 0;
+        unsigned sharingNetworks = 0;
+        for (const CpuNetwork &network : {CpuNetwork{&VehicleDetection, FLAGS_nstreams, FLAGS_nthreads}, CpuNetwork{&PedestriansDetection, FLAGS_nstreams_p, FLAGS_nthreads_p},
+                                          CpuNetwork{&GeneralDetection, FLAGS_nstreams_y, FLAGS_nthreads_y}, CpuNetwork{&VPDetection, FLAGS_nstreams_vp, FLAGS_nthreads_vp}})
+        {
+            if (!network.detector->enabled())
+            {
+                continue;
+            }
+            if (network.detector->deviceName != "CPU")
+            {
+                if (!network.streams.empty() || network.threads > 0)
+                {
+                    BOOST_LOG_TRIVIAL(warning) << "CPU streams and threads are ignored for " << network.detector->topoName << " on " << network.detector->deviceName;
+                }
+                continue;
             }
-            else if (!FLAGS_c.empty())
+            cpuNetworks.push_back(network);
+            if (network.threads > 0)
             {
-                // Load Extensions for other plugins not CPU
-                core.SetConfig({{InferenceEngine::PluginConfigParams::KEY_CONFIG_FILE, FLAGS_c}}, deviceName);
+                reservedThreads += network.threads;
+            }
+            else
+            {
+                sharingNetworks++;
+            }
+        }
+        if (reservedThreads > cpuBudget.inferenceThreads())
+        {
+            BOOST_LOG_TRIVIAL(warning) << reservedThreads << " CPU threads asked for the networks, more than the " << cpuBudget.inferenceThreads() << " inference threads";
+        }
+        for (const CpuNetwork &network : cpuNetworks)
+        {
+            const unsigned threads = network.threads > 0 ? network.threads : cpuBudget.inferenceThreadsPerNetwork(sharingNetworks, reservedThreads);
+            std::map<std::string, std::string> &config = network.detector->pluginConfig;
+            config[InferenceEngine::PluginConfigParams::KEY_CPU_THREADS_NUM] = std::to_string(threads);
+            // The plugin binds the threads of every network to the cores from 0 on: they only stay on the inference
+            // cores of the budget, clear of the pinned tracking and I/O threads, for a single network that fits them.
+            // Several networks would all be bound to the same first cores.
+            const bool ownCores = cpuNetworks.size() == 1 && threads <= cpuBudget.inferenceThreads();
+            std::string bind = FLAGS_cpu_bind;
+            if (bind.empty())
+            {
+                bind = cpuBudget.pinning() && ownCores ? InferenceEngine::PluginConfigParams::YES : InferenceEngine::PluginConfigParams::NO;
+                if (cpuBudget.pinning() && !ownCores)
+                {
+                    BOOST_LOG_TRIVIAL(info) << network.detector->topoName << ": threads left unbound, the plugin would bind them to the cores of another network or stage";
+                }
+            }
+            else if (bind == InferenceEngine::PluginConfigParams::YES && !ownCores)
+            {
+                BOOST_LOG_TRIVIAL(warning) << network.detector->topoName << ": -cpu_bind YES binds it to cores 0-" << threads - 1
+                                           << ", shared with " << (cpuNetworks.size() > 1 ? "the other CPU networks" : "the tracking and I/O threads");
+            }
+            config[InferenceEngine::PluginConfigParams::KEY_CPU_BIND_THREAD] = bind;
+            if (!network.streams.empty())
+            {
+                unsigned streams = network.streams == "auto" ? CpuBudget::autoStreams(threads, FLAGS_n_async) : std::stoul(network.streams);
+                if (streams > threads)
+                {
+                    BOOST_LOG_TRIVIAL(warning) << network.detector->topoName << ": " << streams << " streams need a thread each, using " << threads;
+                    streams = threads;
+                }
+                if (streams > FLAGS_n_async)
+                {
+                    BOOST_LOG_TRIVIAL(warning) << network.detector->topoName << ": only " << FLAGS_n_async << " infer requests (-n_async) keep " << streams << " streams busy";
+                }
+                config[InferenceEngine::PluginConfigParams::KEY_CPU_THROUGHPUT_STREAMS] = std::to_string(streams);
             }
-
-            pluginsForDevices[deviceName] = core;
+        }
+        if (!FLAGS_cache_dir.empty())
+        {
+            networkCache.reset(new NetworkCache(FLAGS_cache_dir));
+        }
+        // Networks load in the background while the streams open, the areas of interest are drawn
+        // and the database is set up. Every detector waits for its network on first use.
+        // The Inference Engine does not promise that a Core compiles two networks at once, so
+        // networks of the same device only read their IR side by side.
+        // With -lazy_load the optional networks, YOLO and VP, are only loaded once their first frames
+        // arrive, by the inference stage waiting for them. startupMs covers the others.
+        const bool lazyGeneral = FLAGS_lazy_load;
+        // Counted before any load starts, a network loaded early must not find the count at zero
+        // while others are still to be launched
+        for (const BaseDetection *detector : {static_cast<const BaseDetection *>(&VehicleDetection), static_cast<const BaseDetection *>(&PedestriansDetection),
+                                              static_cast<const BaseDetection *>(&GeneralDetection), static_cast<const BaseDetection *>(&VPDetection)})
+        {
+            const bool lazy = lazyGeneral && (detector == &GeneralDetection || detector == &VPDetection);
+            if (detector->enabled() && !lazy)
+            {
+                networksLoading++;
+            }
+        }
+        auto loadInBackground = [&](BaseDetection &detector, const std::string &deviceName, bool dynamic, bool lazy) {
+            if (!detector.enabled())
+            {
+                return;
+            }
+            std::shared_future<void> pluginReady = pluginsReady.at(deviceName);
+            std::mutex &deviceLock = deviceLocks[deviceName];
+            // A deferred load runs on the first thread waiting for it
+            detector.loading = std::async(lazy ? std::launch::deferred : std::launch::async, [&, pluginReady, dynamic, lazy] {
+                pluginReady.get();
+                Load(detector).into(*pluginsForDevices.at(deviceName), detector.deviceName, dynamic, networkCache.get(), &deviceLock);
+                if (lazy)
+                {
+                    BOOST_LOG_TRIVIAL(info) << detector.topoName << " loaded on first use, "
+                                            << std::fixed << std::setprecision(2)
+                                            << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - processStart).count()
+                                            << " ms after start";
+                }
+                else if (--networksLoading == 0)
+                {
+                    startupMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - processStart).count();
+                    BOOST_LOG_TRIVIAL(info) << "Networks ready " << std::fixed << std::setprecision(2) << startupMs.load() << " ms after start"
+                                            << (networkCache ? ", " + std::to_string(networkCache->imported()) + " imported from -cache_dir and " +
+                                                                   std::to_string(networkCache->exported()) + " compiled into it"
+                                                             : std::string());
+                }
+            }).share();
+        };
+        loadInBackground(VehicleDetection, FLAGS_d, dynamicBatch(FLAGS_d), false);
+        loadInBackground(PedestriansDetection, FLAGS_d_p, dynamicBatch(FLAGS_d_p), false);
+        loadInBackground(GeneralDetection, FLAGS_d_y, false, lazyGeneral);
+        loadInBackground(VPDetection, FLAGS_d_vp, dynamicBatch(FLAGS_d_vp), lazyGeneral);
+
+        // ---------------------Offline processing of a recorded file-------------------------------------------
+        if (FLAGS_segments > 0)
+        {
+            if (ParseInputList(FLAGS_i).size() != 1)
+            {
+                throw std::invalid_argument("Parameter -segments takes a single input file");
+            }
+            OfflineOptions options;
+            options.segments = FLAGS_segments;
+            options.overlapSeconds = FLAGS_overlap;
+            options.ringSize = FLAGS_n_ring;
+            options.collisions = FLAGS_collision;
+            options.outputPrefix = FLAGS_offline_out;
+            // The segments get copies of the detectors, their networks must be there
+            for (BaseDetection *detector : {static_cast<BaseDetection *>(&VehicleDetection), static_cast<BaseDetection *>(&PedestriansDetection),
+                                            static_cast<BaseDetection *>(&VPDetection), static_cast<BaseDetection *>(&GeneralDetection)})
+            {
+                detector->waitLoaded();
+            }
+            ProcessOffline(FLAGS_i, options, VehicleDetection, PedestriansDetection, VPDetection, GeneralDetection);
+            BOOST_LOG_TRIVIAL(info) << "Execution successful";
+            return 0;
         }
 
-        // --------------------Load networks (Generated xml/bin files)-------------------------------------------
-        Load(VehicleDetection).into(pluginsForDevices[FLAGS_d], FLAGS_d, false);
-        Load(PedestriansDetection).into(pluginsForDevices[FLAGS_d_p], FLAGS_d_p, false);
-        Load(GeneralDetection).into(pluginsForDevices[FLAGS_d_y], FLAGS_d_y, false);
-        Load(VPDetection).into(pluginsForDevices[FLAGS_d_vp], FLAGS_d_vp, false);
+        // Frames are kept alive for batching and for the asynchronous API. Every
+        // detection lane holds at most n_async batches, so that bounds the frames
+        // in flight and every stream gets a pool for them plus its decode ring.
+        const int numLanes = std::max((vp_enabled ? 2 : 0) + (yolo_enabled ? 1 : 0) + (vp2_enabled ? 1 : 0), 1);
+        const size_t maxFramesInFlight = numLanes * FLAGS_n_async * pipelineBatch;
 
-        // Read input (video) frames, need to keep multiple frames stored
-        // for batching and for when using asynchronous API.
-        const int maxNumInputFrames = FLAGS_n_async * VehicleDetection.maxBatch + 1; // +1 to avoid overwrite
-        cv::Mat *inputFrames = new cv::Mat[maxNumInputFrames];
-        cv::Mat *inputFrames2 = new cv::Mat[maxNumInputFrames];
+        // Latency of every pipeline stage, recorded by the threads running them
+        PipelineStats pipelineStats;
 
-        std::queue<cv::Mat *> inputFramePtrs, inputFramePtrs_clean;
-        for (int fi = 0; fi < maxNumInputFrames; fi++)
+        // -----------------------------Read input -----------------------------------------------------
+        BOOST_LOG_TRIVIAL(info) << "Reading input";
+        std::vector<std::string> sources = ParseInputList(FLAGS_i);
+        const bool multiStream = (sources.size() > 1);
+        std::vector<std::unique_ptr<StreamContext>> streams;
+        for (size_t s = 0; s < sources.size(); s++)
         {
-            inputFramePtrs.push(&inputFrames[fi]);
-            inputFramePtrs_clean.push(&inputFrames2[fi]);
+            // Every stream decodes video files, image sequences or cameras on its own thread.
+            streams.emplace_back(new StreamContext(s, sources[s], FLAGS_n_ring, maxFramesInFlight, FLAGS_motion_t, FLAGS_motion_refresh));
+            StreamContext &ctx = *streams.back();
+            if (FLAGS_live)
+            {
+                ctx.cap.setLiveMode(FLAGS_max_age);
+            }
+            if (FLAGS_bench)
+            {
+                ctx.cap.setLoops(FLAGS_bench_loops);
+            }
+            ctx.cap.setStats(&pipelineStats);
+            ctx.tracking_system.setStats(&pipelineStats);
+            if (!ctx.cap.open(ctx.source))
+            { // Open the camera or the file indicated in the argument
+                throw std::invalid_argument("Cannot open input file or camera: " + ctx.source);
+            }
+            ctx.winname = multiStream ? "Detection result - " + ctx.source : "Detection result";
+            ctx.snapshotName = multiStream ? "snapshot_" + std::to_string(s) + ".bmp" : "snapshot.bmp";
         }
+        BOOST_LOG_TRIVIAL(info) << streams.size() << " input stream(s) sharing the loaded networks";
 
         //-----------------------Define Regions of Interest (ROI)-----------------------------------------------------
-        RegionsOfInterest scene;
-
-        cap.read(scene.orig);
-        // Do deep copy to preserve original frame
-        scene.aux = scene.orig.clone();
-        scene.out = scene.orig.clone();
-        cv::Mat aux_mask;
-        std::vector<cv::Mat> mask_sidewalk;
-        std::vector<cv::Mat> mask_crosswalk;
-        std::vector<std::pair<cv::Mat, int>> mask_streets;
-
-        cv::Mat first_frame_masked = scene.orig.clone();
-
-        // To draw areas of interest you should run the command with the -show_selection argument
-        if (FLAGS_show_selection)
+        for (auto &&stream : streams)
         {
-            int ret = 0;
+            StreamContext &ctx = *stream;
+            RegionsOfInterest &scene = ctx.scene;
 
-            // Define Crop Area
-            std::string winname;
-            winname = "Crop";
-            cv::namedWindow(winname);
-            cv::moveWindow(winname, 10, 10);
-            cv::setMouseCallback(winname, CallBCrop, &scene);
-            ret = CropFrame(winname, &scene);
-            if (ret < 0)
+            if (!ctx.cap.read(ctx.firstFrame))
             {
-                return FAIL;
+                throw std::invalid_argument("Cannot read a frame from: " + ctx.source);
             }
-
-            // Define Draw Areas
-            cv::destroyWindow(winname);
-            winname = "Draw Areas";
-            cv::namedWindow(winname);
-            cv::moveWindow(winname, 10, 10);
-            cv::setMouseCallback(winname, CallBDraw, &scene);
-            ret = DrawAreasOfInterest(winname, &scene);
-            if (ret < 0)
+            // Do deep copy to preserve original frame
+            scene.orig = ctx.firstFrame.clean().clone();
+            scene.aux = scene.orig.clone();
+            scene.out = scene.orig.clone();
+            ctx.crop = cv::Rect(cv::Point(0, 0), scene.orig.size());
+
+            // To draw areas of interest you should run the command with the -show_selection argument
+            if (FLAGS_show_selection)
             {
-                return FAIL;
-            }
-
-            // Show Results
-            cv::destroyWindow(winname);
-            winname = "Result";
-            cv::namedWindow(winname);
-            cv::moveWindow(winname, 10, 10);
-            cv::imshow(winname, scene.out);
-            std::cout << "Showing selection result, press any key to continue." << std::endl;
+                int ret = 0;
+                std::cout << "Areas of interest for " << ctx.source << std::endl;
+
+                // Define Crop Area
+                std::string winname;
+                winname = "Crop";
+                cv::namedWindow(winname);
+                cv::moveWindow(winname, 10, 10);
+                cv::setMouseCallback(winname, CallBCrop, &scene);
+                ret = CropFrame(winname, &scene);
+                if (ret < 0)
+                {
+                    return FAIL;
+                }
 
-            cv::waitKey();
-            aux_mask = scene.mask;
-            mask_crosswalk = scene.mask_crosswalks;
-            mask_sidewalk = scene.mask_sidewalks;
-            mask_streets = scene.mask_streets;
+                // Define Draw Areas
+                cv::destroyWindow(winname);
+                winname = "Draw Areas";
+                cv::namedWindow(winname);
+                cv::moveWindow(winname, 10, 10);
+                cv::setMouseCallback(winname, CallBDraw, &scene);
+                ret = DrawAreasOfInterest(winname, &scene);
+                if (ret < 0)
+                {
+                    return FAIL;
+                }
 
-            cv::bitwise_and(scene.orig, aux_mask, first_frame_masked);
-            cv::imshow(winname, first_frame_masked);
-            cv::waitKey();
-            cv::destroyWindow(winname);
+                // Show Results
+                cv::destroyWindow(winname);
+                winname = "Result";
+                cv::namedWindow(winname);
+                cv::moveWindow(winname, 10, 10);
+                cv::imshow(winname, scene.out);
+                std::cout << "Showing selection result, press any key to continue." << std::endl;
+
+                cv::waitKey();
+                ctx.aux_mask = scene.mask;
+                ctx.crop = scene.crop;
+                ctx.mask_crosswalk = scene.mask_crosswalks;
+                ctx.mask_sidewalk = scene.mask_sidewalks;
+                ctx.mask_streets = scene.mask_streets;
+
+                // Detectors only get the cropped area, translated back to frame coordinates
+                cv::imshow(winname, scene.orig(ctx.crop));
+                cv::waitKey();
+                cv::destroyWindow(winname);
+
+                ctx.tracking_system.setMask(&ctx.aux_mask, &ctx.mask_crosswalk, &ctx.mask_sidewalk, &ctx.mask_streets);
+            }
+#ifdef ENABLED_DB
+            if (FLAGS_show_graph)
+                ctx.tracking_system.setUpCollections(ctx.id == 0 ? "" : "_" + std::to_string(ctx.id));
+#endif
         }
 
         // ----------------------------Do inference-------------------------------------------------------------
@@ -313,87 +673,216 @@ int main(int argc, char *argv[])
         std::chrono::high_resolution_clock::time_point wallclockEnd;
 
         /* Variable Declarations */
-        bool firstFrame = true;
-        bool firstFrameWithDetections = true;
-        bool haveMoreFrames = true;
-        bool done = false;
-        int numFrames = 0;
-        int numSyncFrames = 0;
         int totalFrames = 0;
         double ocv_decode_time_vehicle = 0;
         double ocv_decode_time_pedestrians = 0;
         double ocv_render_time = 0;
-        cv::Mat *lastOutputFrame;
-        std::vector<std::pair<cv::Rect, int>> firstResults;
-        const int update_frame = 0;
-        int update_counter = 0;
-        std::string last_event;
-        TrackingSystem tracking_system(&last_event);
+        DetectionInterval detectionInterval(FLAGS_det_interval, FLAGS_target_fps, maxFramesInFlight / 2);
+        // Completed infer requests and new batches wake the inference stage up instead of it polling
+        PipelineEvents pipelineEvents;
+        VehicleDetection.events = &pipelineEvents;
+        PedestriansDetection.events = &pipelineEvents;
+        VPDetection.events = &pipelineEvents;
+        GeneralDetection.events = &pipelineEvents;
+        VehicleDetection.stats = &pipelineStats;
+        PedestriansDetection.stats = &pipelineStats;
+        VPDetection.stats = &pipelineStats;
+        GeneralDetection.stats = &pipelineStats;
+        RuntimeTuner tuner(FLAGS_auto_tune, FLAGS_max_latency, FLAGS_n_async, pipelineBatch);
+
+        // Every stage runs on its own thread:
+        //  - read: takes decoded frames from the streams and batches the ones to detect
+        //  - inference: submits the batches and joins the results of every detector of a frame
+        //  - render (this thread): tracks and draws the frames in read order
+        //  - display: shows the latest drawn frame of every stream at its own rate and reads the keys
+        // frameOrder holds one entry per frame read and not rendered yet, true when the frame
+        // went to the detectors, so its capacity bounds the frames in flight.
+        BoundedQueue<bool> frameOrder("frames in flight", maxFramesInFlight);
+        BoundedQueue<FramePipelineFifoItem> detectionQueue("detection batches", FLAGS_n_async);
+        BoundedQueue<FramePipelineFifoItem> trackQueue("tracker-only frames", maxFramesInFlight);
+        BoundedQueue<DetectedFrame> resultQueue("detection results", maxFramesInFlight);
+        std::atomic<bool> stopReading(false);
+        std::atomic<size_t> framesInDetection(0);
+        std::exception_ptr readError;
+        std::exception_ptr inferenceError;
+        // Batches handed to the detectors, written by the read stage
+        uint64_t batchesSubmitted = 0;
+        uint64_t framesBatched = 0;
+        uint64_t deadlineBatches = 0;
+        // From the start of the process to the first frame with detection results, set by the inference stage
+        double firstDetectionMs = 0;
+
+        // Tracking and database writes of every stream share these pools, sized by the CPU budget.
+        // The thread calling the tracking pool runs a share of the trackers too.
+        ThreadPool trackingPool("tracking", cpuBudget.trackingThreads() - 1, [&cpuBudget](unsigned index) {
+            cpuBudget.pinCurrentThread(CpuBudget::Tracking, index + 1);
+        });
+        ThreadPool ioPool("database", 1, [&cpuBudget](unsigned) {
+            cpuBudget.pinCurrentThread(CpuBudget::Io);
+        });
+        for (auto &&stream : streams)
+        {
+            stream->tracking_system.setThreadPools(&trackingPool, &ioPool);
+        }
 
-        if (FLAGS_show_selection)
+        // HighGUI is only used from the display thread from now on
+        std::unique_ptr<FrameDisplay> display;
+        if (!FLAGS_no_show)
         {
-            tracking_system.setMask(&aux_mask, &mask_crosswalk, &mask_sidewalk, &mask_streets);
+            std::vector<std::string> windowNames;
+            for (auto &&stream : streams)
+            {
+                windowNames.push_back(stream->winname);
+            }
+            display.reset(new FrameDisplay(windowNames, FLAGS_display_fps, FLAGS_display_scale));
+            display->start();
         }
-#ifdef ENABLED_DB
-        if (FLAGS_show_graph)
-            tracking_system.setUpCollections();
-#endif
-        // Structure to hold frame and associated data which are passed along
-        //  from stage to stage for each to do its work
 
-        // Queues to pass information across pipeline stages
-        wallclockStart = std::chrono::high_resolution_clock::now();
-        /** Start inference & calc performance **/
-        do
+        if (FLAGS_bench)
         {
-            std::chrono::high_resolution_clock::time_point a = std::chrono::high_resolution_clock::now();
-            std::chrono::high_resolution_clock::time_point b = std::chrono::high_resolution_clock::now();
-            ms detection_time;
-            detection_time = std::chrono::duration_cast<ms>(b - a);
-            std::chrono::high_resolution_clock::time_point t0;
-            std::chrono::high_resolution_clock::time_point t1;
+            // The frame rate measured does not include loading the networks
+            for (BaseDetection *detector : {static_cast<BaseDetection *>(&VehicleDetection), static_cast<BaseDetection *>(&PedestriansDetection),
+                                            static_cast<BaseDetection *>(&VPDetection), static_cast<BaseDetection *>(&GeneralDetection)})
+            {
+                detector->waitLoaded();
+            }
+        }
+        wallclockStart = std::chrono::high_resolution_clock::now();
 
-            //------------------------------------------------------------------------------------
-            //------------------- Frame Read Stage -----------------------------------------------
-            //------------------------------------------------------------------------------------
-            if (haveMoreFrames && (inputFramePtrs.size() >= VehicleDetection.maxBatch))
+        //------------------------------------------------------------------------------------
+        //------------------- Frame Read Stage -----------------------------------------------
+        //------------------------------------------------------------------------------------
+        std::thread readStage([&] {
+            cpuBudget.pinCurrentThread(CpuBudget::Io);
+            try
             {
+                bool firstFrame = true;
+                size_t nextStream = 0;
+                uint64_t frameSeq = 0;
                 FramePipelineFifoItem ps0;
-                for (numFrames = 0; numFrames < VehicleDetection.maxBatch; numFrames++)
+                const std::chrono::milliseconds batchDeadline(FLAGS_batch_deadline);
+                // Streams in a row that had no frame ready, and how long to wait once all of them had none
+                size_t streamsIdle = 0;
+                const std::chrono::milliseconds idlePoll(10);
+                auto submitBatch = [&] {
+                    if (!ps0.batchOfInputFrames.empty())
+                    {
+                        batchesSubmitted++;
+                        framesBatched += ps0.batchOfInputFrames.size();
+                        detectionQueue.push(std::move(ps0));
+                        pipelineEvents.notify();
+                        ps0 = FramePipelineFifoItem();
+                    }
+                };
+                while (!stopReading)
                 {
+                    // Take streams round-robin so frames of different cameras
+                    // are batched into the same infer request
+                    StreamContext *ctx = nullptr;
+                    for (size_t s = 0; s < streams.size() && ctx == nullptr; s++)
+                    {
+                        StreamContext &candidate = *streams[nextStream];
+                        nextStream = (nextStream + 1) % streams.size();
+                        if (candidate.haveMoreFrames)
+                        {
+                            ctx = &candidate;
+                        }
+                    }
+                    if (ctx == nullptr)
+                    {
+                        break;
+                    }
+
                     // Read in a frame
-                    cv::Mat *curFrame = &scene.orig;
-                    cv::Mat *curFrame_clean;
+                    FrameRef curFrame;
 
-                    if (totalFrames > 0)
+                    if (ctx->firstFrameRead)
                     {
-                        curFrame = inputFramePtrs.front();
-                        curFrame_clean = inputFramePtrs_clean.front();
-                        inputFramePtrs.pop();
-                        inputFramePtrs_clean.pop();
-                        if (FLAGS_show_selection)
+                        // Never block on one stream, a stalled camera would hold back all the others.
+                        // Only wait for a frame once a whole round of streams had none ready.
+                        std::chrono::milliseconds timeout = streamsIdle >= streams.size() ? idlePoll : std::chrono::milliseconds(0);
+                        const bool deadlineOpen = batchDeadline.count() > 0 && !ps0.batchOfInputFrames.empty();
+                        if (deadlineOpen)
                         {
-                            haveMoreFrames = cap.read(*curFrame_clean);
-                            cv::bitwise_and(*curFrame_clean, aux_mask, *curFrame);
+                            // No longer than the open batch may wait
+                            const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - ps0.readTime);
+                            timeout = std::min(timeout, std::max(batchDeadline - waited, std::chrono::milliseconds(0)));
                         }
-                        else
+                        ctx->haveMoreFrames = ctx->cap.read(curFrame, timeout);
+                        if (!ctx->haveMoreFrames)
                         {
-                            haveMoreFrames = cap.read(*curFrame);
-                            curFrame_clean = curFrame;
+                            // Stream ended, try the next one
+                            continue;
                         }
+                        if (!curFrame)
+                        {
+                            streamsIdle++;
+                            if (deadlineOpen && std::chrono::high_resolution_clock::now() - ps0.readTime >= batchDeadline)
+                            {
+                                // Deadline of the batch expired while waiting for the decoders
+                                deadlineBatches++;
+                                submitBatch();
+                            }
+                            // Nothing decoded yet on this stream, go on with the next one
+                            continue;
+                        }
+                        streamsIdle = 0;
                     }
                     else
                     {
-                        curFrame = &first_frame_masked;
-                        curFrame_clean = &scene.orig;
+                        curFrame = std::move(ctx->firstFrame);
+                        ctx->firstFrameRead = true;
                     }
-                    if (!haveMoreFrames)
+                    // Zero-copy view of the area of interest for the detectors
+                    curFrame.setRegion(ctx->crop);
+                    const uint64_t curFrameSeq = frameSeq++;
+                    totalFrames++;
+                    ctx->totalFrames++;
+                    const bool detect = detectionInterval.detect(ctx->update_counter);
+                    // The first frame of a stream always goes through the detectors
+                    const bool moved = ctx->totalFrames > 1 && detect ? ctx->motion.moved(curFrame.image()) : true;
+                    bool toDetectors = detect && moved;
+                    // Wait for room in the pipeline. Frames of a partial batch could be the
+                    // ones the render stage is waiting for, so they are submitted first.
+                    if (!frameOrder.tryPush(toDetectors))
                     {
-                        break;
+                        submitBatch();
+                        if (!frameOrder.push(toDetectors))
+                        {
+                            break;
+                        }
+                    }
+                    if (toDetectors)
+                    {
+                        if (ps0.batchOfInputFrames.empty())
+                        {
+                            ps0.readTime = std::chrono::high_resolution_clock::now();
+                        }
+                        ps0.batchOfInputFrames.push_back(std::move(curFrame));
+                        ps0.batchOfStreamIds.push_back(ctx->id);
+                        ps0.batchOfFrameSeqs.push_back(curFrameSeq);
+                        framesInDetection++;
+                        if (ps0.batchOfInputFrames.size() >= static_cast<size_t>(tuner.batchSize()))
+                        {
+                            submitBatch();
+                        }
+                        else if (batchDeadline.count() > 0 && std::chrono::high_resolution_clock::now() - ps0.readTime >= batchDeadline)
+                        {
+                            deadlineBatches++;
+                            submitBatch();
+                        }
+                    }
+                    else
+                    {
+                        // Tracker-only frame, the tracking system extrapolates the objects,
+                        // or static frame that reuses the last detections
+                        FramePipelineFifoItem track;
+                        track.outputFrame = std::move(curFrame);
+                        track.streamId = ctx->id;
+                        track.frameSeq = curFrameSeq;
+                        track.reuseResults = detect;
+                        trackQueue.push(std::move(track));
                     }
-                    totalFrames++;
-                    ps0.batchOfInputFrames.push_back(curFrame);
-                    ps0.batchOfInputFrames_clean.push_back(curFrame_clean);
                     if (firstFrame && !FLAGS_no_show)
                     {
                         BOOST_LOG_TRIVIAL(info) << "Press 's' key to save a snapshot, press any other key to stop";
@@ -401,328 +890,520 @@ int main(int argc, char *argv[])
 
                     firstFrame = false;
                 }
-                pipeS0Fifo.push(ps0);
-            }
-
-            if (vp_enabled)
-            {
-                VehicleDetection.run_inferrence(&pipeS0Fifo, &pipeS1toS2Fifo);
-                VehicleDetection.wait_results(&pipeS1toS4Fifo);
-                PedestriansDetection.run_inferrence(&pipeS1toS2Fifo);
-                PedestriansDetection.wait_results(&pipeS3toS4Fifo);
-            }
-
-            if (vp2_enabled)
-            {
-                VPDetection.run_inferrence(&pipeS0Fifo);
-                VPDetection.wait_results(&pipeS1ytoS4Fifo);
+                submitBatch();
             }
-
-            if (yolo_enabled)
+            catch (...)
             {
-                GeneralDetection.run_inferrence(&pipeS0Fifo);
-                GeneralDetection.wait_results(&pipeS1ytoS4Fifo);
+                readError = std::current_exception();
             }
-
-            /* *** Pipeline Stage 4: Render Results *** */
-            if (((!pipeS3toS4Fifo.empty() && !pipeS1toS4Fifo.empty()) && vp_enabled) || (!pipeS1ytoS4Fifo.empty() && yolo_enabled) || (!pipeS1ytoS4Fifo.empty() && vp2_enabled))
+            detectionQueue.close();
+            trackQueue.close();
+            frameOrder.close();
+            pipelineEvents.notify();
+        });
+
+        //------------------------------------------------------------------------------------
+        //------------------- Inference Stage ------------------------------------------------
+        //------------------------------------------------------------------------------------
+        std::thread inferenceStage([&] {
+            cpuBudget.pinCurrentThread(CpuBudget::Io);
+            try
             {
-
-                FramePipelineFifoItem ps3s4i;
-                FramePipelineFifoItem ps1s4i;
-                FramePipelineFifoItem ps1ys4i;
-
-                cv::Mat outputFrame;
-                cv::Mat *outputFrame2;
-                cv::Mat outputFrame_clean;
-                cv::Mat *outputFrame2_clean;
-
-                if (vp_enabled)
+                // Every batch is fanned out to the lanes, which run side by side on the
+                // same frames, and their results are joined on the frame sequence number
+                DetectionJoin join(vp_enabled, yolo_enabled || vp2_enabled);
+                BaseDetection &generalLane = vp2_enabled ? static_cast<BaseDetection &>(VPDetection) : GeneralDetection;
+                while (true)
                 {
-                    ps3s4i = pipeS3toS4Fifo.front();
-                    pipeS3toS4Fifo.pop();
-                    ps1s4i = pipeS1toS4Fifo.front();
-                    pipeS1toS4Fifo.pop();
-
-                    outputFrame = *(ps3s4i.outputFrame);
-                    outputFrame2 = ps3s4i.outputFrame;
-                    outputFrame_clean = *(ps3s4i.outputFrame_clean);
-                    outputFrame2_clean = ps3s4i.outputFrame_clean;
-
-                    // Draw box around Vehicles
-                    for (auto &&loc : ps1s4i.resultsLocations)
+                    // Events raised from now on end the idle wait at the bottom of the loop
+                    const uint64_t eventSnapshot = pipelineEvents.snapshot();
+                    bool progress = false;
+                    const int asyncDepth = tuner.asyncDepth();
+                    VehicleDetection.setActiveRequests(asyncDepth);
+                    PedestriansDetection.setActiveRequests(asyncDepth);
+                    generalLane.setActiveRequests(asyncDepth);
+                    FramePipelineFifoItem batch;
+                    if (pipeS0toS1Fifo.empty() && pipeS0toS2Fifo.empty() && pipeS0ytoS1yFifo.empty() && detectionQueue.tryPop(batch))
                     {
-                        if (!FLAGS_tracking)
+                        join.expect(batch);
+                        if (vp_enabled)
                         {
-                            cv::rectangle(outputFrame_clean, loc.first, COLOR_CAR, 1);
+                            pipeS0toS1Fifo.push(batch);
+                            pipeS0toS2Fifo.push(batch);
                         }
-                        if (firstFrameWithDetections || update_counter == update_frame)
+                        if (yolo_enabled || vp2_enabled)
                         {
-                            firstResults.push_back(std::make_pair(loc.first, LABEL_CAR));
+                            pipeS0ytoS1yFifo.push(batch);
                         }
+                        progress = true;
                     }
-                    // Draw box around Pedestrians
-                    for (auto &&loc : ps3s4i.resultsLocations)
+
+                    if (vp_enabled)
                     {
-                        if (!FLAGS_tracking)
-                        {
-                            cv::rectangle(outputFrame_clean, loc.first, COLOR_PERSON, 1);
-                        }
-                        if (firstFrameWithDetections || update_counter == update_frame)
-                        {
-                            firstResults.push_back(std::make_pair(loc.first, LABEL_PERSON));
-                        }
+                        progress |= VehicleDetection.run_inferrence(&pipeS0toS1Fifo);
+                        progress |= PedestriansDetection.run_inferrence(&pipeS0toS2Fifo);
+                        progress |= VehicleDetection.wait_results(&pipeS1toS4Fifo);
+                        progress |= PedestriansDetection.wait_results(&pipeS3toS4Fifo);
+                        join.add(DetectionJoin::Vehicles, pipeS1toS4Fifo);
+                        join.add(DetectionJoin::Pedestrians, pipeS3toS4Fifo);
                     }
-                }
-
-                if (yolo_enabled)
-                {
-                    ps1ys4i = pipeS1ytoS4Fifo.front();
-                    pipeS1ytoS4Fifo.pop();
 
-                    outputFrame = *(ps1ys4i.outputFrame);
-                    outputFrame2 = ps1ys4i.outputFrame;
-                    outputFrame_clean = *(ps1ys4i.outputFrame_clean);
-                    outputFrame2_clean = ps1ys4i.outputFrame_clean;
+                    if (yolo_enabled || vp2_enabled)
+                    {
+                        progress |= generalLane.run_inferrence(&pipeS0ytoS1yFifo);
+                        progress |= generalLane.wait_results(&pipeS1ytoS4Fifo);
+                        join.add(DetectionJoin::General, pipeS1ytoS4Fifo);
+                    }
 
-                    // Tracking and coloring results
-                    for (auto &&loc : ps1ys4i.resultsLocations)
+                    // Frames leave in read order once every lane returned its results, whatever
+                    // the order the infer requests completed in
+                    DetectedFrame detected;
+                    while (join.pop(detected))
                     {
-                        if (!FLAGS_tracking)
-                        {
-                            cv::Scalar color_obj;
-                            switch (loc.second)
-                            {
-                            case LABEL_PERSON:
-                                color_obj = COLOR_PERSON;
-                                break;
-                            case LABEL_CAR:
-                                color_obj = COLOR_CAR;
-                                break;
-                            default:
-                                color_obj = COLOR_UNKNOWN;
-                                break;
-                            }
-                            cv::rectangle(outputFrame_clean, loc.first, color_obj, 1);
-                        }
-                        if (firstFrameWithDetections || update_counter == update_frame)
+                        if (firstDetectionMs == 0)
                         {
-                            firstResults.push_back(loc);
+                            firstDetectionMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - processStart).count();
+                            BOOST_LOG_TRIVIAL(info) << "First detection " << std::fixed << std::setprecision(2) << firstDetectionMs << " ms after start";
                         }
+                        resultQueue.push(std::move(detected));
+                        progress = true;
+                    }
+
+                    const bool inFlight = VehicleDetection.requestsInProcess() || PedestriansDetection.requestsInProcess() ||
+                                          generalLane.requestsInProcess() || join.waiting() > 0;
+                    const bool lanesEmpty = pipeS0toS1Fifo.empty() && pipeS0toS2Fifo.empty() && pipeS0ytoS1yFifo.empty();
+                    if (!progress && !inFlight && lanesEmpty && detectionQueue.drained())
+                    {
+                        break;
+                    }
+                    if (!progress)
+                    {
+                        // Waiting on the inference engine or on the read stage, sleep until either has news.
+                        // The timeout only guards against a request that never calls back.
+                        pipelineEvents.waitFor(eventSnapshot, std::chrono::milliseconds(100));
                     }
                 }
+            }
+            catch (...)
+            {
+                inferenceError = std::current_exception();
+                stopReading = true;
+                detectionQueue.close();
+            }
+            resultQueue.close();
+        });
+
+        // Unblock the other stages, whether rendering ended, stopped early or threw, and wait for them
+        auto stopStages = [&] {
+            stopReading = true;
+            frameOrder.close();
+            detectionQueue.close();
+            trackQueue.close();
+            resultQueue.close();
+            pipelineEvents.notify();
+            if (readStage.joinable())
+            {
+                readStage.join();
+            }
+            if (inferenceStage.joinable())
+            {
+                inferenceStage.join();
+            }
+        };
+        // An exception out of the render loop would otherwise destroy the stage threads
+        // still joinable, which terminates the process before the error is reported
+        struct StageGuard
+        {
+            std::function<void()> stop;
+            ~StageGuard() { stop(); }
+        } stageGuard{stopStages};
+
+        /* *** Pipeline Stage 4: Render Results *** */
+        bool inferred;
+        uint64_t renderedSeq = 0;
+        // Inference time of the last detected frame, shown until the next one
+        double detectionTimeMs = 0;
+        // Detections per label over all the frames, for the benchmark report
+        std::map<int, uint64_t> objectCounts;
+        // Detections of every frame, to compare runs with different models or precisions
+        std::unique_ptr<DetectionLog> detectionLog;
+        if (!FLAGS_det_out.empty() || !FLAGS_det_ref.empty())
+        {
+            detectionLog.reset(new DetectionLog());
+        }
+        std::chrono::high_resolution_clock::time_point lastStatsReport = wallclockStart;
+        while (frameOrder.pop(inferred))
+        {
+            std::chrono::high_resolution_clock::time_point t0;
+            std::chrono::high_resolution_clock::time_point t1;
 
-                if (vp2_enabled)
-                {
-                    ps1ys4i = pipeS1ytoS4Fifo.front();
-                    pipeS1ytoS4Fifo.pop();
+            FramePipelineFifoItem ps3s4i;
+            FramePipelineFifoItem ps1s4i;
+            FramePipelineFifoItem ps1ys4i;
 
-                    outputFrame = *(ps1ys4i.outputFrame);
-                    outputFrame2 = ps1ys4i.outputFrame;
-                    outputFrame_clean = *(ps1ys4i.outputFrame_clean);
-                    outputFrame2_clean = ps1ys4i.outputFrame_clean;
+            FrameRef outputFrameRef;
+            int streamId = 0;
+            bool reused = false;
+            double detectionLatency = -1;
+            uint64_t outputSeq = 0;
 
-                    // Tracking and coloring results
-                    for (auto &&loc : ps1ys4i.resultsLocations)
-                    {
-                        if (loc.second == 1)
-                        {
-                            loc.second = LABEL_PERSON;
-                        }
-                        else if (loc.second == 0)
-                        {
-                            loc.second = LABEL_BICYCLE;
-                        }
-                        if (!FLAGS_tracking)
-                        {
-                            cv::Scalar color_obj;
-                            switch (loc.second)
-                            {
-                            case LABEL_PERSON:
-                                color_obj = COLOR_PERSON;
-                                break;
-                            case LABEL_BICYCLE:
-                                color_obj = COLOR_PERSON;
-                                break;
-                            case LABEL_CAR:
-                                color_obj = COLOR_CAR;
-                                break;
-                            default:
-                                color_obj = COLOR_UNKNOWN;
-                                break;
-                            }
-                            cv::rectangle(outputFrame_clean, loc.first, color_obj, 1);
-                        }
-                        if (firstFrameWithDetections || update_counter == update_frame)
-                        {
-                            firstResults.push_back(loc);
-                        }
-                    }
+            if (!inferred)
+            {
+                FramePipelineFifoItem track;
+                if (!trackQueue.pop(track))
+                {
+                    break;
                 }
-                
-                // Drawing Results
-                if (FLAGS_tracking)
+                outputFrameRef = track.outputFrame;
+                streamId = track.streamId;
+                reused = track.reuseResults;
+                outputSeq = track.frameSeq;
+            }
+            else
+            {
+                DetectedFrame detectedFrame;
+                if (!resultQueue.pop(detectedFrame))
                 {
-                    if (firstFrameWithDetections)
+                    break;
+                }
+                ps1s4i = std::move(detectedFrame.vehicles);
+                ps3s4i = std::move(detectedFrame.pedestrians);
+                ps1ys4i = std::move(detectedFrame.general);
+                const FramePipelineFifoItem &detectedItem = vp_enabled ? ps3s4i : ps1ys4i;
+                outputFrameRef = detectedItem.outputFrame;
+                streamId = detectedItem.streamId;
+                outputSeq = detectedItem.frameSeq;
+                framesInDetection--;
+                detectionTimeMs = (vp_enabled ? ps1s4i : ps1ys4i).inferMs;
+                detectionLatency = std::chrono::duration_cast<ms>(std::chrono::high_resolution_clock::now() - detectedItem.readTime).count();
+            }
+            const bool detected = inferred || reused;
+            // Tracking relies on frames coming strictly in read order
+            if (outputSeq != renderedSeq++)
+            {
+                throw std::logic_error("Frame " + std::to_string(outputSeq) + " rendered out of order");
+            }
+
+            cv::Mat &outputFrame_clean = outputFrameRef.clean();
+            StreamContext &ctx = *streams[streamId];
+            TrackingSystem &tracking_system = ctx.tracking_system;
+            std::vector<std::pair<cv::Rect, int>> &firstResults = ctx.firstResults;
+            // Render covers drawing, annotating and showing the frame. Tracking and collisions
+            // are stages of their own, their time is taken out of it.
+            const std::chrono::high_resolution_clock::time_point renderStart = std::chrono::high_resolution_clock::now();
+            std::chrono::high_resolution_clock::duration otherStages(0);
+
+            if (reused)
+            {
+                // Nothing moved since the last detection of this stream, apply its results again
+                ps1s4i.resultsLocations = ctx.lastVehicleResults;
+                ps3s4i.resultsLocations = ctx.lastPedestrianResults;
+                ps1ys4i.resultsLocations = ctx.lastGeneralResults;
+            }
+            else if (inferred)
+            {
+                ctx.lastVehicleResults = ps1s4i.resultsLocations;
+                ctx.lastPedestrianResults = ps3s4i.resultsLocations;
+                ctx.lastGeneralResults = ps1ys4i.resultsLocations;
+            }
+
+            if (vp_enabled)
+            {
+                // Draw box around Vehicles
+                for (auto &&loc : ps1s4i.resultsLocations)
+                {
+                    if (!FLAGS_tracking)
                     {
-                        tracking_system.setFrameWidth(outputFrame.cols);
-                        tracking_system.setFrameHeight(outputFrame.rows);
-                        tracking_system.setInitTarget(firstResults);
-                        tracking_system.initTrackingSystem();
+                        cv::rectangle(outputFrame_clean, loc.first, COLOR_CAR, 1);
                     }
-                    if (update_counter == update_frame)
+                    if (ctx.firstFrameWithDetections || detected)
                     {
-                        tracking_system.updateTrackingSystem(firstResults);
+                        firstResults.push_back(std::make_pair(loc.first, LABEL_CAR));
                     }
-                    int tracking_success = tracking_system.startTracking(outputFrame);
-                    if (tracking_success == FAIL)
+                }
+                // Draw box around Pedestrians
+                for (auto &&loc : ps3s4i.resultsLocations)
+                {
+                    if (!FLAGS_tracking)
                     {
-                        break;
+                        cv::rectangle(outputFrame_clean, loc.first, COLOR_PERSON, 1);
                     }
-                    if (tracking_system.getTrackerManager().getTrackerVec().size() != 0)
+                    if (ctx.firstFrameWithDetections || detected)
                     {
-                        if (FLAGS_collision)
-                        {
-                            tracking_system.detectCollisions();
-                        }
-                        tracking_system.drawTrackingResult(outputFrame_clean);
+                        firstResults.push_back(std::make_pair(loc.first, LABEL_PERSON));
                     }
                 }
+            }
 
-                // Counting objects in the frame
-                if (update_counter == update_frame)
+            if (yolo_enabled)
+            {
+                // Tracking and coloring results
+                for (auto &&loc : ps1ys4i.resultsLocations)
                 {
-                    int n_person = 0;
-                    int n_car = 0;
-                    int n_bus = 0;
-                    int n_truck = 0;
-                    int n_bike = 0;
-                    int n_motorbike = 0;
-                    int n_ukn = 0;
-                    for (auto &&i : firstResults)
+                    if (!FLAGS_tracking)
                     {
-                        switch (i.second)
+                        cv::Scalar color_obj;
+                        switch (loc.second)
                         {
                         case LABEL_PERSON:
-                            n_person++;
+                            color_obj = COLOR_PERSON;
                             break;
                         case LABEL_CAR:
-                            n_car++;
+                            color_obj = COLOR_CAR;
                             break;
-                        case LABEL_BUS:
-                            n_bus++;
+                        default:
+                            color_obj = COLOR_UNKNOWN;
                             break;
-                        case LABEL_TRUCK:
-                            n_truck++;
+                        }
+                        cv::rectangle(outputFrame_clean, loc.first, color_obj, 1);
+                    }
+                    if (ctx.firstFrameWithDetections || detected)
+                    {
+                        firstResults.push_back(loc);
+                    }
+                }
+            }
+
+            if (vp2_enabled)
+            {
+                // Tracking and coloring results
+                for (auto &&loc : ps1ys4i.resultsLocations)
+                {
+                    if (loc.second == 1)
+                    {
+                        loc.second = LABEL_PERSON;
+                    }
+                    else if (loc.second == 0)
+                    {
+                        loc.second = LABEL_BICYCLE;
+                    }
+                    if (!FLAGS_tracking)
+                    {
+                        cv::Scalar color_obj;
+                        switch (loc.second)
+                        {
+                        case LABEL_PERSON:
+                            color_obj = COLOR_PERSON;
                             break;
                         case LABEL_BICYCLE:
-                            n_bike++;
+                            color_obj = COLOR_PERSON;
                             break;
-                        case LABEL_MOTORBIKE:
-                            n_motorbike++;
+                        case LABEL_CAR:
+                            color_obj = COLOR_CAR;
                             break;
                         default:
-                            n_ukn++;
+                            color_obj = COLOR_UNKNOWN;
                             break;
                         }
+                        cv::rectangle(outputFrame_clean, loc.first, color_obj, 1);
+                    }
+                    if (ctx.firstFrameWithDetections || detected)
+                    {
+                        firstResults.push_back(loc);
                     }
                 }
-
-                firstFrameWithDetections = false;
-                firstResults.clear();
-                update_counter++;
-                if (update_counter > update_frame)
+            }
+            
+            // Drawing Results
+            if (FLAGS_tracking)
+            {
+                StageTimer trackingTimer(&pipelineStats, PipelineStats::Tracking);
+                if (ctx.firstFrameWithDetections)
                 {
-                    update_counter = 0;
+                    tracking_system.setFrameWidth(outputFrame_clean.cols);
+                    tracking_system.setFrameHeight(outputFrame_clean.rows);
+                    tracking_system.setInitTarget(firstResults);
+                    tracking_system.initTrackingSystem();
                 }
-                if (FLAGS_show_selection)
+                if (detected)
                 {
-                    cv::addWeighted(aux_mask, 0.05, outputFrame_clean, 1.0, 0.0, outputFrame_clean);
-                    cv::polylines(outputFrame_clean, scene.mask_vertices, true, cv::Scalar(255, 0, 0), 1);
+                    tracking_system.updateTrackingSystem(firstResults);
                 }
-                // ----------------------------Execution statistics -----------------------------------------------------
-                std::ostringstream out;
-                std::ostringstream out1;
-                std::ostringstream out2;
-
-                ocv_decode_time_pedestrians = 0;
-                ocv_decode_time_vehicle = 0;
-
-                cv::putText(outputFrame_clean, out1.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.5, cv::Scalar(255, 0, 0));
-                cv::putText(outputFrame_clean, out2.str(), cv::Point2f(0, 50), cv::FONT_HERSHEY_TRIPLEX, 0.5, cv::Scalar(0, 255, 0));
-
-                // When running asynchronously, timing metrics are not accurate so do not display them
-                if (!runningAsync)
+                int tracking_success = tracking_system.startTracking(outputFrame_clean);
+                otherStages += trackingTimer.stop();
+                if (tracking_success == FAIL)
+                {
+                    stopReading = true;
+                    break;
+                }
+                if (tracking_system.getTrackerManager().getTrackerVec().size() != 0)
                 {
-                    out.str("");
-                    out << "Vehicle detection time ";
-                    if (VehicleDetection.maxBatch > 1)
+                    if (FLAGS_collision)
                     {
-                        out << "(batch size = " << VehicleDetection.maxBatch << ") ";
+                        StageTimer collisionTimer(&pipelineStats, PipelineStats::Collision);
+                        tracking_system.detectCollisions();
+                        otherStages += collisionTimer.stop();
                     }
-                    out << ": " << std::fixed << std::setprecision(2) << detection_time.count()
-                        << " ms ("
-                        << 1000.F * numSyncFrames / detection_time.count() << " fps)";
-                    cv::putText(outputFrame_clean, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.5,
-                                cv::Scalar(255, 0, 0));
+                    tracking_system.drawTrackingResult(outputFrame_clean);
                 }
+            }
 
-                // -----------------------Display Results ---------------------------------------------
-                t0 = std::chrono::high_resolution_clock::now();
-                if (!FLAGS_no_show)
+            // Counting objects in the frame
+            if (detected)
+            {
+                int n_person = 0;
+                int n_car = 0;
+                int n_bus = 0;
+                int n_truck = 0;
+                int n_bike = 0;
+                int n_motorbike = 0;
+                int n_ukn = 0;
+                for (auto &&i : firstResults)
                 {
-                    std::string winname = "Detection result";
-                    cv::namedWindow(winname);
-                    cv::moveWindow(winname, 10, 10);
-                    cv::imshow(winname, outputFrame_clean);
-                    lastOutputFrame = &outputFrame_clean;
+                    objectCounts[i.second]++;
+                    switch (i.second)
+                    {
+                    case LABEL_PERSON:
+                        n_person++;
+                        break;
+                    case LABEL_CAR:
+                        n_car++;
+                        break;
+                    case LABEL_BUS:
+                        n_bus++;
+                        break;
+                    case LABEL_TRUCK:
+                        n_truck++;
+                        break;
+                    case LABEL_BICYCLE:
+                        n_bike++;
+                        break;
+                    case LABEL_MOTORBIKE:
+                        n_motorbike++;
+                        break;
+                    default:
+                        n_ukn++;
+                        break;
+                    }
                 }
-                t1 = std::chrono::high_resolution_clock::now();
-                ocv_render_time += std::chrono::duration_cast<ms>(t1 - t0).count();
+            }
 
-                // Watch for keypress to stop or snapshot
-                int keyPressed;
-                if (-1 != (keyPressed = cv::waitKey(1)))
+            if (detectionLog && detected)
+            {
+                detectionLog->add(ctx.id, outputFrameRef.position(), firstResults);
+            }
+            ctx.firstFrameWithDetections = false;
+            firstResults.clear();
+            if (FLAGS_show_selection)
+            {
+                cv::addWeighted(ctx.aux_mask, 0.05, outputFrame_clean, 1.0, 0.0, outputFrame_clean);
+                cv::polylines(outputFrame_clean, ctx.scene.mask_vertices, true, cv::Scalar(255, 0, 0), 1);
+            }
+            // ----------------------------Execution statistics -----------------------------------------------------
+            std::ostringstream out;
+            std::ostringstream out1;
+            std::ostringstream out2;
+
+            ocv_decode_time_pedestrians = 0;
+            ocv_decode_time_vehicle = 0;
+
+            cv::putText(outputFrame_clean, out1.str(), cv::Point2f(0, 25), cv::FONT_HERSHEY_TRIPLEX, 0.5, cv::Scalar(255, 0, 0));
+            cv::putText(outputFrame_clean, out2.str(), cv::Point2f(0, 50), cv::FONT_HERSHEY_TRIPLEX, 0.5, cv::Scalar(0, 255, 0));
+
+            // When running asynchronously, timing metrics are not accurate so do not display them
+            if (!runningAsync)
+            {
+                out.str("");
+                out << "Vehicle detection time ";
+                if (VehicleDetection.maxBatch > 1)
                 {
-                    if ('s' == keyPressed)
-                    {
-                        // Save screen to output file
-                        BOOST_LOG_TRIVIAL(info) << "Saving snapshot of image";
-                        cv::imwrite("snapshot.bmp", outputFrame);
-                    }
-                    else
-                    {
-                        haveMoreFrames = false;
-                    }
+                    out << "(batch size = " << VehicleDetection.maxBatch << ") ";
                 }
+                out << ": " << std::fixed << std::setprecision(2) << detectionTimeMs
+                    << " ms ("
+                    << (detectionTimeMs > 0 ? 1000.F * VehicleDetection.maxBatch / detectionTimeMs : 0.F) << " fps)";
+                cv::putText(outputFrame_clean, out.str(), cv::Point2f(0, 75), cv::FONT_HERSHEY_TRIPLEX, 0.5,
+                            cv::Scalar(255, 0, 0));
+            }
+
+            // End-to-end latency of this frame, from the decoder to the screen
+            double latencyMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - outputFrameRef.captureTime()).count();
+            ctx.latencySumMs += latencyMs;
+            ctx.latencyMaxMs = std::max(ctx.latencyMaxMs, latencyMs);
+            ctx.latencyFrames++;
+            tuner.frameRendered(latencyMs);
+            if (FLAGS_live)
+            {
+                std::ostringstream out;
+                out << "Latency: " << std::fixed << std::setprecision(1) << latencyMs << " ms, dropped frames: "
+                    << ctx.cap.framesDropped();
+                cv::putText(outputFrame_clean, out.str(), cv::Point2f(0, 95), cv::FONT_HERSHEY_TRIPLEX, 0.5,
+                            cv::Scalar(255, 0, 0));
+            }
 
-                // Done with frame buffer, return to queue
-                inputFramePtrs.push(outputFrame2);
-                inputFramePtrs_clean.push(outputFrame2_clean);
+            // -----------------------Display Results ---------------------------------------------
+            t0 = std::chrono::high_resolution_clock::now();
+            if (display)
+            {
+                display->show(ctx.id, outputFrame_clean);
+                // Kept rather than copied, its buffer goes back to the pool with the next frame shown
+                ctx.lastOutputFrame = outputFrameRef;
+            }
+            t1 = std::chrono::high_resolution_clock::now();
+            ocv_render_time += std::chrono::duration_cast<ms>(t1 - t0).count();
+            pipelineStats[PipelineStats::Render].record(t1 - renderStart - otherStages);
+            if (FLAGS_stats_period > 0 && t1 - lastStatsReport >= std::chrono::seconds(FLAGS_stats_period))
+            {
+                pipelineStats.report("Stage latencies so far");
+                lastStatsReport = t1;
             }
 
-            // Wait until break from key press after all pipeline stages have completed
-            done = !haveMoreFrames && pipeS0toS1Fifo.empty() && pipeS1toS2Fifo.empty() && pipeS2toS3Fifo.empty() && pipeS3toS4Fifo.empty() && pipeS0toS2Fifo.empty() && pipeS1toS4Fifo.empty() && pipeS0ytoS1yFifo.empty() && pipeS1ytoS4Fifo.empty();
-            // End of file we just keep last image/frame displayed to let user check what was shown
-            if (done)
+            // Watch for keypress to stop or snapshot
+            int keyPressed;
+            if (display && display->pollKey(keyPressed))
             {
-                // Done processing, save time
-                wallclockEnd = std::chrono::high_resolution_clock::now();
+                if ('s' == keyPressed)
+                {
+                    // Save screen to output file
+                    BOOST_LOG_TRIVIAL(info) << "Saving snapshot of image";
+                    cv::imwrite(ctx.snapshotName, outputFrame_clean);
+                }
+                else
+                {
+                    // Stop reading, the frames already in the pipeline are still rendered
+                    stopReading = true;
+                }
+            }
+
+            // Done with the frame, its buffer goes back to the pool with the last reference
+            detectionInterval.frameRendered(detectionLatency, framesInDetection.load());
+        }
+
+        // Done processing, save time
+        wallclockEnd = std::chrono::high_resolution_clock::now();
 
-                if (!FLAGS_no_wait && !FLAGS_no_show)
+        stopStages();
+        if (readError)
+        {
+            std::rethrow_exception(readError);
+        }
+        if (inferenceError)
+        {
+            std::rethrow_exception(inferenceError);
+        }
+
+        // End of file we just keep last image/frame displayed to let user check what was shown
+        int keyPressed;
+        if (!FLAGS_no_wait && display)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Press 's' key to save a snapshot, press any other key to exit";
+            while (display->waitKey(keyPressed) && keyPressed == 's')
+            {
+                // Save screen to output file
+                BOOST_LOG_TRIVIAL(info) << "Saving snapshot of image";
+                for (auto &&stream : streams)
                 {
-                    BOOST_LOG_TRIVIAL(info) << "Press 's' key to save a snapshot, press any other key to exit";
-                    while (cv::waitKey(0) == 's')
+                    if (stream->lastOutputFrame)
                     {
-                        // Save screen to output file
-                        BOOST_LOG_TRIVIAL(info) << "Saving snapshot of image";
-                        cv::imwrite("snapshot.bmp", *lastOutputFrame);
+                        cv::imwrite(stream->snapshotName, stream->lastOutputFrame.clean());
                     }
-                    haveMoreFrames = false;
-                    break;
                 }
             }
-        } while (!done);
+        }
+        if (display)
+        {
+            display->stop();
+        }
 
         // Calculate total run time
         ms total_wallclock_time = std::chrono::duration_cast<ms>(wallclockEnd - wallclockStart);
@@ -731,11 +1412,127 @@ int main(int argc, char *argv[])
         BOOST_LOG_TRIVIAL(info) << "     Total main-loop time:" << std::fixed << std::setprecision(2)
                                 << total_wallclock_time.count() << " ms ";
         BOOST_LOG_TRIVIAL(info) << "           Total # frames:" << totalFrames;
+        BOOST_LOG_TRIVIAL(info) << "  Idle waits for inference:" << pipelineEvents.idleWaits();
+        pipelineStats.report("Stage latencies");
+        BOOST_LOG_TRIVIAL(info) << batchesSubmitted << " batches submitted, " << std::fixed << std::setprecision(2)
+                                << (batchesSubmitted ? static_cast<double>(framesBatched) / batchesSubmitted : 0.0)
+                                << " frames per batch on average, " << deadlineBatches << " cut short by -batch_deadline";
+        trackingPool.logStats();
+        ioPool.logStats();
+        cpuBudget.reportContention();
+        frameOrder.logStats();
+        detectionQueue.logStats();
+        trackQueue.logStats();
+        resultQueue.logStats();
+        if (tuner.enabled())
+        {
+            BOOST_LOG_TRIVIAL(info) << "Auto-tune settled on " << tuner.asyncDepth() << " infer requests and batches of "
+                                    << tuner.batchSize() << " after " << tuner.settingChanges() << " changes";
+        }
+        for (const BaseDetection *detector : {static_cast<const BaseDetection *>(&VehicleDetection), static_cast<const BaseDetection *>(&PedestriansDetection),
+                                              static_cast<const BaseDetection *>(&VPDetection), static_cast<const BaseDetection *>(&GeneralDetection)})
+        {
+            if (detector->enabled())
+            {
+                BOOST_LOG_TRIVIAL(info) << detector->topoName << ": " << detector->completedOutOfOrder << " infer requests completed out of order";
+            }
+        }
         float avgTimePerFrameMs = total_wallclock_time.count() / (float)totalFrames;
         BOOST_LOG_TRIVIAL(info) << "   Average time per frame:" << std::fixed << std::setprecision(2)
                                 << avgTimePerFrameMs << " ms "
                                 << "(" << 1000.0F / avgTimePerFrameMs << " fps)";
-        delete[] inputFrames;
+        for (auto &&stream : streams)
+        {
+            if (stream->motion.enabled())
+            {
+                const MotionGate &motion = stream->motion;
+                BOOST_LOG_TRIVIAL(info) << "Stream " << stream->source << ": motion gate skipped " << motion.framesSkipped()
+                                        << " of " << motion.framesChecked() << " frames ("
+                                        << (motion.framesChecked() ? 100.0 * motion.framesSkipped() / motion.framesChecked() : 0.0)
+                                        << "% of the detections saved)";
+            }
+            BOOST_LOG_TRIVIAL(info) << "Stream " << stream->source << ": " << stream->cap.framesDecoded() << " frames decoded, "
+                                    << stream->cap.framesDropped() << " dropped, end-to-end latency "
+                                    << std::fixed << std::setprecision(2)
+                                    << (stream->latencyFrames ? stream->latencySumMs / stream->latencyFrames : 0.0)
+                                    << " ms on average, " << stream->latencyMaxMs << " ms at most";
+            const FramePool &pool = stream->cap.framePool();
+            BOOST_LOG_TRIVIAL(info) << "Stream " << stream->source << ": " << pool.framesServed() << " frames served from a pool of "
+                                    << pool.capacity() << ", " << pool.frameBufferReallocations() << " frame buffers reallocated after start-up";
+            if (!FLAGS_auto_resize)
+            {
+                BOOST_LOG_TRIVIAL(info) << "Stream " << stream->source << ": " << pool.tensorsBuilt() << " network inputs preprocessed, "
+                                        << pool.tensorsReused() << " shared between detectors";
+            }
+            stream->cap.stop();
+        }
+        DetectionAgreement agreement;
+        if (detectionLog)
+        {
+            detectionLog->fps = total_wallclock_time.count() > 0 ? 1000.0 * totalFrames / total_wallclock_time.count() : 0.0;
+            for (const BaseDetection *detector : {static_cast<const BaseDetection *>(&VehicleDetection), static_cast<const BaseDetection *>(&PedestriansDetection),
+                                                  static_cast<const BaseDetection *>(&VPDetection), static_cast<const BaseDetection *>(&GeneralDetection)})
+            {
+                if (detector->enabled())
+                {
+                    detectionLog->precision += (detectionLog->precision.empty() ? "" : ",") + detector->precision;
+                }
+            }
+            if (!FLAGS_det_out.empty())
+            {
+                detectionLog->save(FLAGS_det_out);
+                BOOST_LOG_TRIVIAL(info) << "Detections written to " << FLAGS_det_out;
+            }
+            if (!FLAGS_det_ref.empty())
+            {
+                agreement = detectionLog->compare(DetectionLog::load(FLAGS_det_ref), 0.5);
+                agreement.reference = FLAGS_det_ref;
+                BOOST_LOG_TRIVIAL(info) << "Against " << FLAGS_det_ref << " (" << agreement.referencePrecision << ", " << std::fixed << std::setprecision(2)
+                                        << agreement.referenceFps << " fps): " << agreement.frames << " frames compared, recall "
+                                        << agreement.recall() << ", precision " << agreement.precision() << ", mean IoU " << agreement.meanIoU()
+                                        << " at " << detectionLog->fps << " fps (" << detectionLog->precision << ")";
+            }
+        }
+        if (FLAGS_bench)
+        {
+            BenchReport report;
+            report.loops = FLAGS_bench_loops;
+            report.asyncDepth = FLAGS_n_async;
+            report.autoTune = tuner.enabled();
+            report.tunedDepth = tuner.asyncDepth();
+            report.tunedBatch = tuner.batchSize();
+            report.detectionInterval = FLAGS_det_interval;
+            for (const BaseDetection *detector : {static_cast<const BaseDetection *>(&VehicleDetection), static_cast<const BaseDetection *>(&PedestriansDetection),
+                                                  static_cast<const BaseDetection *>(&VPDetection), static_cast<const BaseDetection *>(&GeneralDetection)})
+            {
+                if (detector->enabled())
+                {
+                    report.models.push_back(BenchModel{detector->topoName, detector->commandLineFlag, detector->deviceName, detector->maxBatch,
+                                                            detector->precision});
+                }
+            }
+            for (auto &&stream : streams)
+            {
+                report.streams.push_back(BenchStream{stream->source, stream->cap.framesDecoded(), stream->cap.framesDropped(),
+                                                     stream->latencyFrames ? stream->latencySumMs / stream->latencyFrames : 0.0,
+                                                     stream->latencyMaxMs});
+            }
+            report.frames = renderedSeq;
+            report.wallclockMs = total_wallclock_time.count();
+            report.startupMs = startupMs;
+            report.firstDetectionMs = firstDetectionMs;
+            for (auto &&count : objectCounts)
+            {
+                report.objects[getLabelStr(count.first)] += count.second;
+            }
+            report.stats = &pipelineStats;
+            if (!FLAGS_det_ref.empty())
+            {
+                report.agreement = &agreement;
+            }
+            report.save(FLAGS_bench_out);
+            BOOST_LOG_TRIVIAL(info) << "Benchmark report written to " << FLAGS_bench_out;
+        }
     }
 
     // Catch Exceptions
@@ -0,0 +1,37 @@
+#include "motion_gate.hpp"
+
+#include <algorithm>
+
+namespace {
+const int thumbnail_width = 96;         // Width of the frames compared, height keeps the aspect ratio
+const double background_alpha = 0.05;   // Learning rate of the background model
+const double pixel_threshold = 25;      // Gray level change counted as a changed pixel
+}
+
+bool MotionGate::moved(const cv::Mat &frame)
+{
+    if (!this -> enabled()) return true;
+    this -> checked++;
+
+    int height = std::max(1, frame.rows * thumbnail_width / std::max(1, frame.cols));
+    cv::resize(frame, this -> thumbnail, cv::Size(thumbnail_width, height), 0, 0, cv::INTER_AREA);
+    cv::cvtColor(this -> thumbnail, this -> gray, cv::COLOR_BGR2GRAY);
+    if (this -> background.empty() || this -> background.size() != this -> gray.size()) {
+        this -> gray.convertTo(this -> background, CV_32F);
+        this -> sinceRefresh = 0;
+        return true;
+    }
+
+    this -> background.convertTo(this -> background8u, CV_8U);
+    cv::absdiff(this -> gray, this -> background8u, this -> difference);
+    cv::threshold(this -> difference, this -> difference, pixel_threshold, 255, cv::THRESH_BINARY);
+    double changed = static_cast<double>(cv::countNonZero(this -> difference)) / this -> difference.total();
+    cv::accumulateWeighted(this -> gray, this -> background, background_alpha);
+
+    if (changed >= this -> threshold || ++this -> sinceRefresh >= this -> refreshInterval) {
+        this -> sinceRefresh = 0;
+        return true;
+    }
+    this -> skipped++;
+    return false;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>
+
+/* ==========================================================================
+
+Class : MotionGate
+
+Cheap test telling whether a frame is worth running the detectors on. The
+frame is downscaled to a small grayscale thumbnail and compared with a
+running-average background model; when the fraction of changed pixels is
+below the threshold the previous detection results are reused. A detection
+is still forced every refreshInterval frames so slow changes are caught.
+
+========================================================================== */
+class MotionGate
+{
+private:
+    double threshold;               // Fraction of changed pixels counted as motion, 0 disables the gate
+    int refreshInterval;            // Maximum number of frames between two detections
+    int sinceRefresh;
+    cv::Mat thumbnail;
+    cv::Mat gray;
+    cv::Mat background;
+    cv::Mat background8u;
+    cv::Mat difference;
+    uint64_t checked;
+    uint64_t skipped;
+
+public:
+    MotionGate(double threshold, int refreshInterval)
+        : threshold(threshold), refreshInterval(refreshInterval), sinceRefresh(0), checked(0), skipped(0) {}
+
+    bool enabled() const { return this -> threshold > 0; }
+
+    // True when the frame has to go through the detectors
+    bool moved(const cv::Mat &frame);
+
+    uint64_t framesChecked() const { return this -> checked; }
+    uint64_t framesSkipped() const { return this -> skipped; }
+};
@@ -0,0 +1,136 @@
+#include "network_cache.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <samples/common.hpp>
+#include <boost/log/trivial.hpp>
+
+// 64 bits FNV-1a, enough to tell model files and settings apart
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t hashBytes(uint64_t hash, const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const std::string &text)
+{
+    // The terminating zero keeps "ab" + "c" apart from "a" + "bc"
+    return hashBytes(hash, text.c_str(), text.size() + 1);
+}
+
+static uint64_t hashFile(uint64_t hash, const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path + " to hash it");
+    }
+    char buffer[1 << 16];
+    while (file) {
+        file.read(buffer, sizeof(buffer));
+        hash = hashBytes(hash, buffer, static_cast<size_t>(file.gcount()));
+    }
+    return hash;
+}
+
+// Model path without directories nor extension
+static std::string modelStem(const std::string &model)
+{
+    const size_t slash = model.find_last_of("/\\");
+    std::string stem = slash == std::string::npos ? model : model.substr(slash + 1);
+    return stem.substr(0, stem.rfind('.'));
+}
+
+NetworkCache::NetworkCache(const std::string &dir) : dir(dir), imports(0), exports(0)
+{
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Cannot create the network cache directory " + dir);
+    }
+}
+
+std::string NetworkCache::entryPath(const InferenceEngine::CNNNetwork &network, const std::string &model, const std::string &device,
+                                    const std::map<std::string, std::string> &config) const
+{
+    uint64_t hash = FNV_OFFSET;
+    hash = hashFile(hash, model);
+    hash = hashFile(hash, fileNameNoExt(model) + ".bin");
+    hash = hashString(hash, device);
+    hash = hashString(hash, std::to_string(network.getBatchSize()));
+    for (auto && input : network.getInputsInfo()) {
+        hash = hashString(hash, input.first);
+        hash = hashString(hash, input.second->getPrecision().name());
+        hash = hashString(hash, std::to_string(static_cast<int>(input.second->getTensorDesc().getLayout())));
+    }
+    for (auto && output : network.getOutputsInfo()) {
+        hash = hashString(hash, output.first);
+        hash = hashString(hash, output.second->getPrecision().name());
+    }
+    for (auto && key : config) {
+        hash = hashString(hash, key.first);
+        hash = hashString(hash, key.second);
+    }
+    const InferenceEngine::Version *version = InferenceEngine::GetInferenceEngineVersion();
+    if (version != nullptr) {
+        hash = hashString(hash, version -> buildNumber);
+    }
+    // Devices such as HETERO:FPGA,CPU are not file name friendly
+    std::string deviceName = device;
+    for (char &c : deviceName) {
+        if (!isalnum(static_cast<unsigned char>(c))) {
+            c = '_';
+        }
+    }
+    std::ostringstream path;
+    path << this -> dir << "/" << modelStem(model) << "_" << deviceName << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".blob";
+    return path.str();
+}
+
+InferenceEngine::ExecutableNetwork NetworkCache::load(InferenceEngine::Core &core, const InferenceEngine::CNNNetwork &network, const std::string &model,
+                                                      const std::string &device, const std::map<std::string, std::string> &config)
+{
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point start = clock::now();
+    const std::string path = this -> entryPath(network, model, device, config);
+    if (std::ifstream(path).good()) {
+        try {
+            InferenceEngine::ExecutableNetwork imported = core.ImportNetwork(path, device, config);
+            this -> imports++;
+            BOOST_LOG_TRIVIAL(info) << "Imported " << path << " in "
+                                    << std::chrono::duration<double, std::milli>(clock::now() - start).count() << " ms";
+            return imported;
+        } catch (const std::exception &error) {
+            BOOST_LOG_TRIVIAL(warning) << "Cannot import " << path << ", compiling the network again: " << error.what();
+        }
+    }
+    InferenceEngine::ExecutableNetwork compiled = core.LoadNetwork(network, device, config);
+    const double compileMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    try {
+        // Written aside and renamed, so a crash never leaves half an entry behind
+        const std::string partial = path + ".part";
+        compiled.Export(partial);
+        if (std::rename(partial.c_str(), path.c_str()) != 0) {
+            std::remove(partial.c_str());
+            throw std::runtime_error("cannot rename " + partial);
+        }
+        this -> exports++;
+        BOOST_LOG_TRIVIAL(info) << "Compiled " << model << " for " << device << " in " << compileMs << " ms, exported to " << path;
+    } catch (const std::exception &error) {
+        BOOST_LOG_TRIVIAL(warning) << "Compiled " << model << " for " << device << " in " << compileMs
+                                   << " ms, it cannot be cached: " << error.what();
+    }
+    return compiled;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <inference_engine.hpp>
+
+/* ==========================================================================
+
+Class : NetworkCache
+
+Directory of networks compiled for a device. The first load of a network
+compiles it and exports the ExecutableNetwork to the cache, later starts
+import it instead of compiling it again. Entries are keyed by a hash of the
+IR files, the device, the batch size, the input and output precisions, the
+plugin config and the Inference Engine build, so any change compiles and
+exports a new entry.
+
+Not every plugin can export a compiled network; for those the network is
+compiled every time, as without a cache, and a warning says so.
+
+========================================================================== */
+class NetworkCache
+{
+private:
+    std::string dir;
+    std::atomic<unsigned> imports;
+    std::atomic<unsigned> exports;
+
+    std::string entryPath(const InferenceEngine::CNNNetwork &network, const std::string &model, const std::string &device,
+                          const std::map<std::string, std::string> &config) const;
+
+public:
+    // dir is created if it does not exist, throws std::runtime_error if it cannot
+    explicit NetworkCache(const std::string &dir);
+
+    // Import network compiled for device from the cache, or compile it and export it.
+    // model is the path of its IR .xml, next to its .bin.
+    InferenceEngine::ExecutableNetwork load(InferenceEngine::Core &core, const InferenceEngine::CNNNetwork &network, const std::string &model,
+                                            const std::string &device, const std::map<std::string, std::string> &config);
+
+    unsigned imported() const { return this -> imports.load(); }
+    unsigned exported() const { return this -> exports.load(); }
+};
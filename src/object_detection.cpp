@@ -2,28 +2,30 @@
 
 void ObjectDetection::submitRequest(){
     if (!this -> enquedFrames) return;
+    if (this -> dynamicBatch) {
+        // Partial batches only cost the frames they hold
+        this -> requests[this -> inputRequestIdx]->SetBatch(this -> enquedFrames);
+    }
     this -> enquedFrames = 0;
     this -> BaseDetection::submitRequest();
 }
 
-void ObjectDetection::enqueue(const cv::Mat &frame) {
+void ObjectDetection::enqueue(const FrameRef &frame) {
     if (!this -> enabled()) return;
     if (this -> enquedFrames >= this -> maxBatch) {
         BOOST_LOG_TRIVIAL(warning) << "Number of frames more than maximum(" << this -> maxBatch << ") processed by Vehicles detector" ;
         return;
     }
     if (nullptr == this -> requests[this -> inputRequestIdx]) {
-	    this -> requests[this -> inputRequestIdx] = this -> net.CreateInferRequestPtr();
+	    this -> createRequest();
     }
-    this -> width = frame.cols;
-    this -> height = frame.rows;
 	InferenceEngine::Blob::Ptr inputBlob;
     if (this -> auto_resize) {
-        inputBlob = wrapMat2Blob(frame);
+        inputBlob = wrapRegion2Blob(frame.image());
         this -> requests[this -> inputRequestIdx]->SetBlob(this -> input, inputBlob);
     } else {
 		inputBlob = this -> requests[this -> inputRequestIdx]->GetBlob(this -> input);
-		matU8ToBlob<uint8_t >(frame, inputBlob, this -> enquedFrames);
+		frameRegion2Blob(frame, inputBlob, this -> enquedFrames);
 	}
     this -> enquedFrames++;
 }
@@ -83,33 +85,44 @@ InferenceEngine::CNNNetwork ObjectDetection::read() {
     return net_readed;
 }
 
-void ObjectDetection::fetchResults(int inputBatchSize) {
+void ObjectDetection::fetchResults(const std::vector<cv::Rect> &frameRegions) {
     if (!this -> enabled()) return;
     if (nullptr == this -> outputRequest) {
         return;
     }
     this -> results.clear();
     const float *detections = this -> outputRequest->GetBlob(this -> output)->buffer().as<float *>();
+    ParseSSDOutput(detections, this -> maxProposalCount, this -> objectSize, this -> detection_threshold, frameRegions, this -> results);
+	// done with request
+	this -> outputRequest = nullptr;
+}
+
+void ParseSSDOutput(const float *detections, int maxProposalCount, int objectSize, float threshold,
+                    const std::vector<cv::Rect> &frameRegions, std::vector<BaseDetection::Result> &results) {
     // pretty much regular SSD post-processing
-	for (int i = 0; i < this -> maxProposalCount; i++) {
-		int proposalOffset = i * this -> objectSize;
+	for (int i = 0; i < maxProposalCount; i++) {
+		int proposalOffset = i * objectSize;
 		float image_id = detections[proposalOffset + 0];
-		Result r;
+		BaseDetection::Result r;
+		if ((image_id < 0) || (image_id >= frameRegions.size())) {  // indicates end of detections
+			break;
+		}
 		r.batchIndex = image_id;
 		r.label = static_cast<int>(detections[proposalOffset + 1]);
 		r.confidence = detections[proposalOffset + 2];
-		if (r.confidence <= this -> detection_threshold) {
+		if (r.confidence <= threshold) {
 			continue;
 		}
-		r.location.x = detections[proposalOffset + 3] * this -> width;
-		r.location.y = detections[proposalOffset + 4] * this -> height;
-		r.location.width = detections[proposalOffset + 5] * this -> width - r.location.x;
-		r.location.height = detections[proposalOffset + 6] * this -> height - r.location.y;
-		if ((image_id < 0) || (image_id >= inputBatchSize)) {  // indicates end of detections
-			break;
-		}
-		this -> results.push_back(r);
+		// Frames of a batch may come from streams with different resolutions
+		// and areas of interest
+		const cv::Rect &region = frameRegions[r.batchIndex];
+		const float width = region.width;
+		const float height = region.height;
+		r.location.x = detections[proposalOffset + 3] * width;
+		r.location.y = detections[proposalOffset + 4] * height;
+		r.location.width = detections[proposalOffset + 5] * width - r.location.x;
+		r.location.height = detections[proposalOffset + 6] * height - r.location.y;
+		r.location += region.tl();
+		results.push_back(r);
 	}
-	// done with request
-	this -> outputRequest = nullptr;
 }
@@ -2,6 +2,12 @@
 
 #include "base_detection.hpp"
 
+// SSD post-processing of a DetectionOutput of maxProposalCount proposals of
+// objectSize values. Boxes above threshold are scaled to the region of their
+// image in the batch and appended to results.
+void ParseSSDOutput(const float *detections, int maxProposalCount, int objectSize, float threshold,
+                    const std::vector<cv::Rect> &frameRegions, std::vector<BaseDetection::Result> &results);
+
 class ObjectDetection : public BaseDetection{
   public:
 	std::string input;
@@ -9,13 +15,11 @@ class ObjectDetection : public BaseDetection{
     int maxProposalCount = 0;
     int objectSize = 0;
     int enquedFrames = 0;
-    float width = 0;
-    float height = 0;
     using BaseDetection::operator=;
 
     void submitRequest() override;
 
-    void enqueue(const cv::Mat &frame) override;
+    void enqueue(const FrameRef &frame) override;
 
 
     ObjectDetection(std::string &commandLineFlag, std::string &deviceName, std::string topoName, 
@@ -25,5 +29,5 @@ class ObjectDetection : public BaseDetection{
     
     InferenceEngine::CNNNetwork read() override;
 
-    void fetchResults(int inputBatchSize) override;
+    void fetchResults(const std::vector<cv::Rect> &frameRegions) override;
 };
\ No newline at end of file
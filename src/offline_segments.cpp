@@ -0,0 +1,327 @@
+#include "offline_segments.hpp"
+#include "detection_join.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#include "frame_reader.hpp"
+#include "Tracker.h"
+
+namespace {
+const double min_match_iou = 0.5;   // Mean IoU over the overlap for two tracks to be the same object
+const int min_match_frames = 3;     // Frames both tracks must be seen in the overlap
+
+// One request at a time, the segments run in parallel instead
+void makeSynchronous(BaseDetection &detector)
+{
+    detector.setAsyncRequests(1);
+}
+
+double intersectionOverUnion(const cv::Rect &a, const cv::Rect &b)
+{
+    double intersection = (a & b).area();
+    double area = a.area() + b.area() - intersection;
+    return area > 0 ? intersection / area : 0;
+}
+
+int globalId(std::map<int, int> &ids, int localId, int &nextId)
+{
+    auto it = ids.find(localId);
+    if (it == ids.end()) {
+        it = ids.insert(std::make_pair(localId, nextId++)).first;
+    }
+    return it -> second;
+}
+}
+
+SegmentDetectors::SegmentDetectors(const ObjectDetection &vehicles, const ObjectDetection &pedestrians,
+                                   const ObjectDetection &vp, const YoloDetection &general)
+    : vehicles(vehicles), pedestrians(pedestrians), vp(vp), general(general)
+{
+    makeSynchronous(this -> vehicles);
+    makeSynchronous(this -> pedestrians);
+    makeSynchronous(this -> vp);
+    makeSynchronous(this -> general);
+}
+
+std::vector<VideoSegment> SplitIntoSegments(int frameCount, unsigned segments, int overlapFrames)
+{
+    const int count = std::max(1, std::min(static_cast<int>(segments), frameCount));
+    const int overlap = std::max(0, std::min(overlapFrames, frameCount / count));
+    std::vector<VideoSegment> result;
+    for (int i = 0; i < count; i++) {
+        const int begin = static_cast<int>(static_cast<long long>(frameCount) * i / count);
+        const int end = static_cast<int>(static_cast<long long>(frameCount) * (i + 1) / count);
+        VideoSegment segment;
+        segment.id = i;
+        segment.firstFrame = std::max(0, begin - overlap);
+        segment.lastFrame = end;
+        segment.ownFirst = (i == 0) ? 0 : begin - overlap / 2;
+        segment.ownLast = (i == count - 1) ? frameCount : end - overlap / 2;
+        result.push_back(segment);
+    }
+    return result;
+}
+
+SegmentResult ProcessSegment(const std::string &source, const VideoSegment &segment, SegmentDetectors &detectors,
+                             size_t ringSize, bool collisions)
+{
+    const bool yolo_enabled = detectors.general.enabled();
+    const bool vp_enabled = (detectors.vehicles.enabled() && detectors.pedestrians.enabled());
+    const bool vp2_enabled = detectors.vp.enabled();
+    const size_t maxBatch = detectors.vehicles.maxBatch;
+
+    SegmentResult result;
+    FrameReader reader(ringSize, maxBatch);
+    if (!reader.open(source, segment.firstFrame)) {
+        throw std::invalid_argument("Cannot open input file: " + source);
+    }
+    std::string last_event;
+    TrackingSystem tracking_system(&last_event);
+    tracking_system.keepCollisionHistory(true);
+
+    FramePipelineFifo pipeS0toS1Fifo;
+    FramePipelineFifo pipeS0toS2Fifo;
+    FramePipelineFifo pipeS0ytoS1yFifo;
+    FramePipelineFifo pipeS1toS4Fifo;
+    FramePipelineFifo pipeS3toS4Fifo;
+    FramePipelineFifo pipeS1ytoS4Fifo;
+
+    DetectionJoin join(vp_enabled, yolo_enabled || vp2_enabled);
+    BaseDetection &generalLane = vp2_enabled ? static_cast<BaseDetection &>(detectors.vp) : detectors.general;
+    uint64_t frameSeq = 0;                      // Frames read since the start of the segment
+    bool firstFrameWithDetections = true;
+    bool haveMoreFrames = true;
+    while (haveMoreFrames && segment.firstFrame + static_cast<int>(frameSeq) < segment.lastFrame) {
+        FramePipelineFifoItem ps0;
+        while (ps0.batchOfInputFrames.size() < maxBatch && segment.firstFrame + static_cast<int>(frameSeq) < segment.lastFrame) {
+            FrameRef curFrame;
+            if (!reader.read(curFrame)) {
+                haveMoreFrames = false;
+                break;
+            }
+            ps0.batchOfInputFrames.push_back(std::move(curFrame));
+            ps0.batchOfStreamIds.push_back(segment.id);
+            ps0.batchOfFrameSeqs.push_back(frameSeq++);
+        }
+        if (ps0.batchOfInputFrames.empty()) {
+            break;
+        }
+
+        // Synchronous requests, every wait_results returns the batch results
+        join.expect(ps0);
+        if (vp_enabled) {
+            pipeS0toS1Fifo.push(ps0);
+            pipeS0toS2Fifo.push(ps0);
+            detectors.vehicles.run_inferrence(&pipeS0toS1Fifo);
+            detectors.pedestrians.run_inferrence(&pipeS0toS2Fifo);
+            detectors.vehicles.wait_results(&pipeS1toS4Fifo);
+            detectors.pedestrians.wait_results(&pipeS3toS4Fifo);
+            join.add(DetectionJoin::Vehicles, pipeS1toS4Fifo);
+            join.add(DetectionJoin::Pedestrians, pipeS3toS4Fifo);
+        }
+        if (yolo_enabled || vp2_enabled) {
+            pipeS0ytoS1yFifo.push(ps0);
+            generalLane.run_inferrence(&pipeS0ytoS1yFifo);
+            generalLane.wait_results(&pipeS1ytoS4Fifo);
+            join.add(DetectionJoin::General, pipeS1ytoS4Fifo);
+        }
+
+        DetectedFrame detected;
+        while (join.pop(detected)) {
+            const FramePipelineFifoItem &first = vp_enabled ? detected.vehicles : detected.general;
+            const int frame = segment.firstFrame + static_cast<int>(first.frameSeq);
+            std::vector<std::pair<cv::Rect, int>> detections;
+            FrameRef outputFrame;
+            if (vp_enabled) {
+                for (auto && loc : detected.vehicles.resultsLocations) {
+                    detections.push_back(std::make_pair(loc.first, LABEL_CAR));
+                }
+                for (auto && loc : detected.pedestrians.resultsLocations) {
+                    detections.push_back(std::make_pair(loc.first, LABEL_PERSON));
+                }
+                outputFrame = detected.pedestrians.outputFrame;
+            }
+            if (yolo_enabled || vp2_enabled) {
+                for (auto && loc : detected.general.resultsLocations) {
+                    int label = loc.second;
+                    if (vp2_enabled) {
+                        label = (label == 1) ? LABEL_PERSON : (label == 0 ? LABEL_BICYCLE : label);
+                    }
+                    detections.push_back(std::make_pair(loc.first, label));
+                }
+                outputFrame = detected.general.outputFrame;
+            }
+            if (!outputFrame) {
+                continue;
+            }
+
+            cv::Mat &image = outputFrame.clean();
+            if (firstFrameWithDetections) {
+                tracking_system.setFrameWidth(image.cols);
+                tracking_system.setFrameHeight(image.rows);
+                tracking_system.setInitTarget(detections);
+                tracking_system.initTrackingSystem();
+                firstFrameWithDetections = false;
+            }
+            tracking_system.updateTrackingSystem(detections);
+            if (tracking_system.startTracking(image) == FAIL) {
+                BOOST_LOG_TRIVIAL(error) << "Segment " << segment.id << ": tracking failed at frame " << frame;
+                haveMoreFrames = false;
+                break;
+            }
+            std::vector<std::shared_ptr<SingleTracker>> trackers = tracking_system.getTrackerManager().getTrackerVec();
+            if (collisions && !trackers.empty()) {
+                Pipe &history = tracking_system.getCollisionHistory();
+                size_t seen = history.size();
+                tracking_system.detectCollisions();
+                for (size_t c = seen; c < history.size(); c++) {
+                    result.collisions.push_back(CollisionRecord{frame, history[c].ob1, history[c].ob2});
+                }
+            }
+            for (auto && tracker : trackers) {
+                result.points.push_back(TrackPoint{frame, tracker -> getTargetID(), tracker -> getLabel(), tracker -> getRect()});
+            }
+            result.frames++;
+        }
+    }
+    reader.stop();
+    return result;
+}
+
+void StitchSegments(const std::vector<VideoSegment> &segments, const std::vector<SegmentResult> &results,
+                    std::vector<TrackPoint> &points, std::vector<CollisionRecord> &collisions)
+{
+    std::vector<std::map<int, int>> globalIds(segments.size());
+    int nextId = 0;
+    for (size_t s = 0; s < segments.size(); s++) {
+        if (s > 0) {
+            // Tracks of both segments seen in the same frames of the overlap
+            const int overlapBegin = segments[s].firstFrame;
+            const int overlapEnd = segments[s - 1].lastFrame;
+            std::multimap<int, const TrackPoint *> previous;
+            for (auto && point : results[s - 1].points) {
+                if (point.frame >= overlapBegin && point.frame < overlapEnd) {
+                    previous.insert(std::make_pair(point.frame, &point));
+                }
+            }
+            std::map<std::pair<int, int>, std::pair<double, int>> scores;
+            for (auto && point : results[s].points) {
+                if (point.frame < overlapBegin || point.frame >= overlapEnd) continue;
+                auto range = previous.equal_range(point.frame);
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (it -> second -> label != point.label) continue;
+                    std::pair<double, int> &score = scores[std::make_pair(it -> second -> trackId, point.trackId)];
+                    score.first += intersectionOverUnion(it -> second -> rect, point.rect);
+                    score.second++;
+                }
+            }
+            std::vector<std::tuple<double, int, int>> candidates;
+            for (auto && score : scores) {
+                double mean = score.second.first / score.second.second;
+                if (score.second.second >= min_match_frames && mean >= min_match_iou) {
+                    candidates.push_back(std::make_tuple(mean, score.first.first, score.first.second));
+                }
+            }
+            std::sort(candidates.rbegin(), candidates.rend());
+            std::map<int, bool> usedPrevious;
+            for (auto && candidate : candidates) {
+                int previousId = std::get<1>(candidate);
+                int currentId = std::get<2>(candidate);
+                if (usedPrevious[previousId] || globalIds[s].count(currentId)) continue;
+                usedPrevious[previousId] = true;
+                globalIds[s][currentId] = globalId(globalIds[s - 1], previousId, nextId);
+            }
+        }
+        for (auto && point : results[s].points) {
+            int id = globalId(globalIds[s], point.trackId, nextId);
+            if (point.frame >= segments[s].ownFirst && point.frame < segments[s].ownLast) {
+                points.push_back(TrackPoint{point.frame, id, point.label, point.rect});
+            }
+        }
+        for (auto && collision : results[s].collisions) {
+            if (collision.frame >= segments[s].ownFirst && collision.frame < segments[s].ownLast) {
+                collisions.push_back(CollisionRecord{collision.frame, globalId(globalIds[s], collision.object1, nextId),
+                                                     globalId(globalIds[s], collision.object2, nextId)});
+            }
+        }
+    }
+}
+
+void ProcessOffline(const std::string &source, const OfflineOptions &options,
+                    const ObjectDetection &vehicles, const ObjectDetection &pedestrians,
+                    const ObjectDetection &vp, const YoloDetection &general)
+{
+    cv::VideoCapture probe;
+    if (source == "cam" || !probe.open(source)) {
+        throw std::invalid_argument("Offline processing needs a video file: " + source);
+    }
+    const int frameCount = static_cast<int>(probe.get(cv::CAP_PROP_FRAME_COUNT));
+    double fps = probe.get(cv::CAP_PROP_FPS);
+    probe.release();
+    if (frameCount <= 0) {
+        throw std::invalid_argument("Cannot get the number of frames of: " + source);
+    }
+    if (fps <= 0) {
+        fps = 25;
+    }
+
+    std::vector<VideoSegment> segments = SplitIntoSegments(frameCount, options.segments,
+                                                           static_cast<int>(options.overlapSeconds * fps));
+    BOOST_LOG_TRIVIAL(info) << "Offline processing of " << frameCount << " frames in " << segments.size() << " segment(s)";
+
+    std::vector<SegmentResult> results(segments.size());
+    std::vector<std::exception_ptr> errors(segments.size());
+    std::vector<std::thread> workers;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (size_t s = 0; s < segments.size(); s++) {
+        workers.emplace_back([&, s]() {
+            try {
+                SegmentDetectors detectors(vehicles, pedestrians, vp, general);
+                results[s] = ProcessSegment(source, segments[s], detectors, options.ringSize, options.collisions);
+                BOOST_LOG_TRIVIAL(info) << "Segment " << s << " done: frames " << segments[s].firstFrame << "-"
+                                        << segments[s].lastFrame << ", " << results[s].frames << " processed";
+            } catch (...) {
+                errors[s] = std::current_exception();
+            }
+        });
+    }
+    for (auto && worker : workers) {
+        worker.join();
+    }
+    for (auto && error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::vector<TrackPoint> points;
+    std::vector<CollisionRecord> collisions;
+    StitchSegments(segments, results, points, collisions);
+
+    std::ofstream tracksFile(options.outputPrefix + "_tracks.csv");
+    tracksFile << "frame,track_id,label,x,y,width,height" << std::endl;
+    for (auto && point : points) {
+        tracksFile << point.frame << ',' << point.trackId << ',' << getLabelStr(point.label) << ','
+                   << point.rect.x << ',' << point.rect.y << ',' << point.rect.width << ',' << point.rect.height << '\n';
+    }
+    std::ofstream collisionsFile(options.outputPrefix + "_collisions.csv");
+    collisionsFile << "frame,object_1,object_2" << std::endl;
+    for (auto && collision : collisions) {
+        collisionsFile << collision.frame << ',' << collision.object1 << ',' << collision.object2 << '\n';
+    }
+    if (!tracksFile || !collisionsFile) {
+        throw std::runtime_error("Cannot write the offline results to " + options.outputPrefix + "_*.csv");
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Offline processing took " << elapsed << " s (" << frameCount / elapsed << " fps), "
+                            << points.size() << " track points and " << collisions.size() << " collisions written to "
+                            << options.outputPrefix << "_tracks.csv and " << options.outputPrefix << "_collisions.csv";
+}
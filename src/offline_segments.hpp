@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "object_detection.hpp"
+#include "yolo_detection.hpp"
+
+// Part of a recorded file processed by one worker. Frames [firstFrame, lastFrame)
+// are decoded, the ones in [ownFirst, ownLast) are reported by this segment and
+// the rest overlap with the neighbours to let the trackers warm up.
+struct VideoSegment
+{
+    int id;
+    int firstFrame;
+    int lastFrame;
+    int ownFirst;
+    int ownLast;
+};
+
+// Position of a tracked object in a frame
+struct TrackPoint
+{
+    int frame;
+    int trackId;
+    int label;
+    cv::Rect rect;
+};
+
+struct CollisionRecord
+{
+    int frame;
+    int object1;
+    int object2;
+};
+
+struct SegmentResult
+{
+    std::vector<TrackPoint> points;
+    std::vector<CollisionRecord> collisions;
+    int frames = 0;
+};
+
+struct OfflineOptions
+{
+    unsigned segments;          // Number of segments processed in parallel
+    double overlapSeconds;      // Overlap between two consecutive segments
+    size_t ringSize;            // Decode ring of every segment
+    bool collisions;            // Run collision detection
+    std::string outputPrefix;   // <prefix>_tracks.csv and <prefix>_collisions.csv
+};
+
+/* ==========================================================================
+
+Struct : SegmentDetectors
+
+Detectors of one segment. They are copies of the loaded detectors, so they
+share the executable networks, with their own synchronous infer request:
+the segments themselves provide the parallelism.
+
+========================================================================== */
+struct SegmentDetectors
+{
+    ObjectDetection vehicles;
+    ObjectDetection pedestrians;
+    ObjectDetection vp;
+    YoloDetection general;
+
+    SegmentDetectors(const ObjectDetection &vehicles, const ObjectDetection &pedestrians,
+                     const ObjectDetection &vp, const YoloDetection &general);
+};
+
+// Split frameCount frames into segments overlapping by overlapFrames
+std::vector<VideoSegment> SplitIntoSegments(int frameCount, unsigned segments, int overlapFrames);
+
+// Decode, detect and track one segment
+SegmentResult ProcessSegment(const std::string &source, const VideoSegment &segment, SegmentDetectors &detectors,
+                             size_t ringSize, bool collisions);
+
+// Join the segment results into one timeline. Tracks of consecutive segments
+// seen in the same place during the overlap are given the same id.
+void StitchSegments(const std::vector<VideoSegment> &segments, const std::vector<SegmentResult> &results,
+                    std::vector<TrackPoint> &points, std::vector<CollisionRecord> &collisions);
+
+// Process a recorded file split into segments on parallel workers and write
+// the stitched tracks and collisions as CSV files
+void ProcessOffline(const std::string &source, const OfflineOptions &options,
+                    const ObjectDetection &vehicles, const ObjectDetection &pedestrians,
+                    const ObjectDetection &vp, const YoloDetection &general);
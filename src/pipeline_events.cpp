@@ -0,0 +1,29 @@
+#include "pipeline_events.hpp"
+
+void PipelineEvents::notify()
+{
+    {
+        std::lock_guard<std::mutex> lock(this -> events_mutex);
+        this -> events++;
+    }
+    this -> raised.notify_all();
+}
+
+uint64_t PipelineEvents::snapshot()
+{
+    std::lock_guard<std::mutex> lock(this -> events_mutex);
+    return this -> events;
+}
+
+bool PipelineEvents::waitFor(uint64_t snapshot, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(this -> events_mutex);
+    this -> sleeps++;
+    return this -> raised.wait_for(lock, timeout, [this, snapshot] { return this -> events != snapshot; });
+}
+
+uint64_t PipelineEvents::idleWaits()
+{
+    std::lock_guard<std::mutex> lock(this -> events_mutex);
+    return this -> sleeps;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/* ==========================================================================
+
+Class : PipelineEvents
+
+Wakes up the pipeline loop when there is work to do. Infer request
+completion callbacks call notify() from the inference engine threads; the
+loop takes a snapshot of the event count before polling its stages and,
+when no stage could make progress, sleeps in waitFor() until the count
+moves past the snapshot. Events raised while the loop was polling are
+therefore never lost.
+
+========================================================================== */
+class PipelineEvents
+{
+private:
+    std::mutex events_mutex;
+    std::condition_variable raised;
+    uint64_t events;
+    uint64_t sleeps;
+
+public:
+    PipelineEvents() : events(0), sleeps(0) {}
+
+    PipelineEvents(const PipelineEvents &) = delete;
+    PipelineEvents &operator=(const PipelineEvents &) = delete;
+
+    void notify();
+
+    // Current event count, to be passed to waitFor()
+    uint64_t snapshot();
+
+    // Sleep until an event is raised after the snapshot was taken, or the
+    // timeout expires. Returns false on timeout.
+    bool waitFor(uint64_t snapshot, std::chrono::milliseconds timeout);
+
+    // Number of times the loop went to sleep
+    uint64_t idleWaits();
+};
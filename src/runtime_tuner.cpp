@@ -0,0 +1,89 @@
+#include "runtime_tuner.hpp"
+
+#include <algorithm>
+
+// Windows a knob is left alone after a step that did not pay off
+static const int HOLD_WINDOWS = 5;
+
+RuntimeTuner::RuntimeTuner(bool enabled, double latencyCeilingMs, int maxDepth, int maxBatch)
+    : on(enabled), latencyCeilingMs(latencyCeilingMs), maxDepth(std::max(maxDepth, 1)), maxBatch(std::max(maxBatch, 1)),
+      depth(enabled ? 1 : std::max(maxDepth, 1)), batch(enabled ? 1 : std::max(maxBatch, 1)), windowFrames(0),
+      windowLatencyMs(0), lastFps(0), lastStep(None), nextGrow(Depth), depthHold(0), batchHold(0), changes(0)
+{
+    if (this -> on) {
+        BOOST_LOG_TRIVIAL(info) << "Auto-tuning up to " << this -> maxDepth << " infer requests and batches of "
+                                << this -> maxBatch << " under " << this -> latencyCeilingMs << " ms of latency";
+    }
+}
+
+void RuntimeTuner::frameRendered(double latencyMs)
+{
+    if (!this -> on) return;
+    clock::time_point now = clock::now();
+    if (this -> windowFrames == 0) {
+        this -> windowStart = now;
+        this -> windowLatencyMs = 0;
+    }
+    this -> windowFrames++;
+    this -> windowLatencyMs += latencyMs;
+    double elapsedMs = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(now - this -> windowStart).count();
+    if (elapsedMs >= 1000.0) {
+        this -> adapt(1000.0 * (this -> windowFrames - 1) / elapsedMs, this -> windowLatencyMs / this -> windowFrames);
+        this -> windowFrames = 0;
+    }
+}
+
+void RuntimeTuner::set(std::atomic<int> &knob, int value, const char *name, double fps, double latencyMs)
+{
+    BOOST_LOG_TRIVIAL(info) << "Auto-tune " << name << " " << knob.load() << " -> " << value << " (output " << fps
+                            << " fps, latency " << latencyMs << " ms)";
+    knob = value;
+    this -> changes++;
+}
+
+void RuntimeTuner::adapt(double fps, double latencyMs)
+{
+    this -> depthHold = std::max(this -> depthHold - 1, 0);
+    this -> batchHold = std::max(this -> batchHold - 1, 0);
+    const Knob step = this -> lastStep;
+    this -> lastStep = None;
+
+    if (latencyMs > this -> latencyCeilingMs) {
+        // Too slow: a smaller batch fills sooner, fewer requests queue less work
+        if (this -> batch > 1) {
+            this -> set(this -> batch, this -> batch - 1, "batch size", fps, latencyMs);
+            this -> batchHold = HOLD_WINDOWS;
+        } else if (this -> depth > 1) {
+            this -> set(this -> depth, this -> depth - 1, "async depth", fps, latencyMs);
+            this -> depthHold = HOLD_WINDOWS;
+        }
+    } else if (step != None && fps < 1.02 * this -> lastFps) {
+        // The last step did not raise the throughput, take it back
+        if (step == Depth) {
+            this -> set(this -> depth, this -> depth - 1, "async depth", fps, latencyMs);
+            this -> depthHold = HOLD_WINDOWS;
+        } else {
+            this -> set(this -> batch, this -> batch - 1, "batch size", fps, latencyMs);
+            this -> batchHold = HOLD_WINDOWS;
+        }
+    } else if (latencyMs < 0.8 * this -> latencyCeilingMs) {
+        const bool canDepth = this -> depth < this -> maxDepth && this -> depthHold == 0;
+        const bool canBatch = this -> batch < this -> maxBatch && this -> batchHold == 0;
+        Knob grow = None;
+        if (canDepth && (this -> nextGrow == Depth || !canBatch)) {
+            grow = Depth;
+        } else if (canBatch) {
+            grow = Batch;
+        }
+        if (grow == Depth) {
+            this -> set(this -> depth, this -> depth + 1, "async depth", fps, latencyMs);
+        } else if (grow == Batch) {
+            this -> set(this -> batch, this -> batch + 1, "batch size", fps, latencyMs);
+        }
+        if (grow != None) {
+            this -> lastStep = grow;
+            this -> nextGrow = (grow == Depth) ? Batch : Depth;
+        }
+    }
+    this -> lastFps = fps;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/log/trivial.hpp>
+
+/* ==========================================================================
+
+Class : RuntimeTuner
+
+Closed-loop tuning of the number of infer requests each detector keeps in
+flight and of the batch assembled by the read stage, looking for the
+highest throughput under an end-to-end latency ceiling. Once per second of
+output the window's frame rate and average latency are compared with the
+previous window:
+  - above the ceiling, the batch shrinks first, then the async depth;
+  - well below it, one knob grows, depth and batch taking turns;
+  - a step that did not pay off in frame rate is reverted and that knob is
+    left alone for a few windows.
+The limits are the -n_async and batch sizes given on the command line.
+Settings are read by the read and inference stages and changed by the
+render stage.
+
+========================================================================== */
+class RuntimeTuner
+{
+private:
+    typedef std::chrono::high_resolution_clock clock;
+
+    enum Knob { None, Depth, Batch };
+
+    bool on;
+    double latencyCeilingMs;
+    int maxDepth;
+    int maxBatch;
+    std::atomic<int> depth;
+    std::atomic<int> batch;
+    clock::time_point windowStart;
+    size_t windowFrames;
+    double windowLatencyMs;
+    double lastFps;
+    Knob lastStep;                  // Knob grown in the previous window, to revert it if useless
+    Knob nextGrow;
+    int depthHold;                  // Windows left before growing the knob again
+    int batchHold;
+    uint64_t changes;
+
+    void adapt(double fps, double latencyMs);
+    void set(std::atomic<int> &knob, int value, const char *name, double fps, double latencyMs);
+
+public:
+    // Without auto-tuning the settings stay at their limits
+    RuntimeTuner(bool enabled, double latencyCeilingMs, int maxDepth, int maxBatch);
+
+    bool enabled() const { return this -> on; }
+
+    // Infer requests each detector may have in flight
+    int asyncDepth() const { return this -> depth.load(std::memory_order_relaxed); }
+    // Frames per batch assembled by the read stage
+    int batchSize() const { return this -> batch.load(std::memory_order_relaxed); }
+
+    // Account for a rendered frame and its end-to-end latency
+    void frameRendered(double latencyMs);
+
+    uint64_t settingChanges() const { return this -> changes; }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "drawer.hpp"
+#include "frame_reader.hpp"
+#include "motion_gate.hpp"
+#include "Tracker.h"
+
+/* ==========================================================================
+
+Struct : StreamContext
+
+State of one input stream in a multi-stream run. Each camera or file has
+its own decoder, areas of interest and tracking system, while the detection
+networks are shared by all of them.
+
+========================================================================== */
+struct StreamContext
+{
+    int id;
+    std::string source;
+    std::string winname;                        // Window showing this stream's results
+    std::string snapshotName;                   // File written when pressing 's'
+    FrameReader cap;
+    RegionsOfInterest scene;
+    cv::Mat aux_mask;
+    cv::Rect crop;                              // Area of the frames fed to the detectors
+    std::vector<cv::Mat> mask_sidewalk;
+    std::vector<cv::Mat> mask_crosswalk;
+    std::vector<std::pair<cv::Mat, int>> mask_streets;
+    FrameRef firstFrame;                        // Frame used to select the areas of interest
+    std::string last_event;
+    TrackingSystem tracking_system;
+    std::vector<std::pair<cv::Rect, int>> firstResults;
+    MotionGate motion;
+    // Last detection results, reused on frames skipped by the motion gate
+    std::vector<std::pair<cv::Rect, int>> lastVehicleResults;
+    std::vector<std::pair<cv::Rect, int>> lastPedestrianResults;
+    std::vector<std::pair<cv::Rect, int>> lastGeneralResults;
+    FrameRef lastOutputFrame;                   // Last frame shown, saved by 's' at the end of the run
+    bool haveMoreFrames = true;
+    bool firstFrameRead = false;                // First frame comes from firstFrame
+    bool firstFrameWithDetections = true;
+    int update_counter = 0;                     // Frames read since the last detection
+    int totalFrames = 0;
+    // End-to-end latency, from decode to display
+    double latencySumMs = 0;
+    double latencyMaxMs = 0;
+    uint64_t latencyFrames = 0;
+
+    StreamContext(int id, const std::string &source, size_t ringSize, size_t framesInFlight,
+                  double motionThreshold, int motionRefresh)
+        // The pool also backs lastOutputFrame
+        : id(id), source(source), cap(ringSize, framesInFlight + 1), tracking_system(&last_event),
+          motion(motionThreshold, motionRefresh) {}
+
+    StreamContext(const StreamContext &) = delete;
+    StreamContext &operator=(const StreamContext &) = delete;
+};
@@ -0,0 +1,125 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <boost/log/trivial.hpp>
+
+ThreadPool::ThreadPool(const std::string &name, unsigned threads, std::function<void(unsigned)> onStart)
+    : name(name), stopping(false), executed(0), queueWaitMs(0), maxQueueWaitMs(0)
+{
+    for (unsigned i = 0; i < threads; i++) {
+        this -> workers.emplace_back(&ThreadPool::workerLoop, this, i, onStart);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this -> tasks_mutex);
+        this -> stopping = true;
+    }
+    this -> task_ready.notify_all();
+    for (auto && worker : this -> workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index, const std::function<void(unsigned)> &onStart)
+{
+    if (onStart) {
+        onStart(index);
+    }
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(this -> tasks_mutex);
+            // Queued tasks still run after stopping was set
+            this -> task_ready.wait(lock, [this] { return this -> stopping || !this -> tasks.empty(); });
+            if (this -> tasks.empty()) {
+                return;
+            }
+            task = std::move(this -> tasks.front());
+            this -> tasks.pop_front();
+            const double waitedMs = std::chrono::duration<double, std::milli>(clock::now() - task.queued).count();
+            this -> executed++;
+            this -> queueWaitMs += waitedMs;
+            this -> maxQueueWaitMs = std::max(this -> maxQueueWaitMs, waitedMs);
+        }
+        task.run();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(this -> tasks_mutex);
+        this -> tasks.push_back(Task{std::move(task), clock::now()});
+    }
+    this -> task_ready.notify_one();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    if (this -> workers.empty()) {
+        task();
+        return;
+    }
+    const std::string &poolName = this -> name;
+    this -> enqueue([task, &poolName] {
+        try {
+            task();
+        } catch (const std::exception &error) {
+            BOOST_LOG_TRIVIAL(error) << poolName << ": task failed: " << error.what();
+        }
+    });
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)> &body)
+{
+    const size_t maxChunks = (count + std::max<size_t>(minChunk, 1) - 1) / std::max<size_t>(minChunk, 1);
+    const size_t chunks = std::min(maxChunks, this -> workers.size() + 1);
+    if (chunks <= 1) {
+        body(0, count);
+        return;
+    }
+    // Chunks left to run and the first error, shared with the workers
+    std::mutex done_mutex;
+    std::condition_variable all_done;
+    size_t pending = chunks - 1;
+    std::exception_ptr error;
+    auto runChunk = [&](size_t chunk) {
+        try {
+            body(chunk * count / chunks, (chunk + 1) * count / chunks);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        this -> enqueue([&, chunk] {
+            runChunk(chunk);
+            std::lock_guard<std::mutex> lock(done_mutex);
+            if (--pending == 0) {
+                all_done.notify_one();
+            }
+        });
+    }
+    // The caller takes its share instead of sleeping
+    runChunk(0);
+    std::unique_lock<std::mutex> lock(done_mutex);
+    all_done.wait(lock, [&] { return pending == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::logStats() const
+{
+    std::lock_guard<std::mutex> lock(this -> tasks_mutex);
+    BOOST_LOG_TRIVIAL(info) << this -> name << " pool: " << this -> workers.size() << " threads ran " << this -> executed
+                            << " tasks, queued " << (this -> executed ? this -> queueWaitMs / this -> executed : 0.0)
+                            << " ms on average and " << this -> maxQueueWaitMs << " ms at most before a thread was free";
+}
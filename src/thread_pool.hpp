@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ==========================================================================
+
+Class : ThreadPool
+
+Fixed set of worker threads created once, replacing threads started per
+task. parallelFor() splits a loop in chunks run by the workers and the
+calling thread, and returns when all of them are done; submit() queues a
+task and returns at once. The time tasks spent queued, waiting for a free
+worker, is the contention metric logged by logStats().
+
+========================================================================== */
+class ThreadPool
+{
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct Task {
+        std::function<void()> run;
+        clock::time_point queued;
+    };
+
+    std::string name;
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    bool stopping;
+    mutable std::mutex tasks_mutex;
+    std::condition_variable task_ready;
+    // Contention metrics
+    uint64_t executed;
+    double queueWaitMs;
+    double maxQueueWaitMs;
+
+    void workerLoop(unsigned index, const std::function<void(unsigned)> &onStart);
+    void enqueue(std::function<void()> task);
+
+public:
+    // onStart runs first on every worker, with its index, e.g. to pin it to a core
+    ThreadPool(const std::string &name, unsigned threads, std::function<void(unsigned)> onStart = nullptr);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Run task on a worker. Exceptions are logged, nobody waits for it.
+    void submit(std::function<void()> task);
+
+    // Run body(begin, end) over [0, count) in chunks of at least minChunk items,
+    // rethrowing the first exception of a chunk
+    void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)> &body);
+
+    size_t size() const { return this -> workers.size(); }
+
+    void logStats() const;
+};
@@ -31,15 +31,19 @@ double IntersectionOverUnion(const DetectionObject &box_1, const DetectionObject
     return area_of_overlap / area_of_union;
 }
 
-void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const InferenceEngine::Blob::Ptr &blob, const unsigned long resized_im_h,
-                       const unsigned long resized_im_w, const unsigned long original_im_h,
-                       const unsigned long original_im_w,
+void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const InferenceEngine::Blob::Ptr &blob, size_t batchIndex,
+                       const unsigned long resized_im_h, const unsigned long resized_im_w,
+                       const unsigned long original_im_h, const unsigned long original_im_w,
                        const double threshold, std::vector<DetectionObject> &objects) {
     // --------------------------- Validating output parameters -------------------------------------
     if (layer->type != "RegionYolo")
         throw std::runtime_error("Invalid output type: " + layer->type + ". RegionYolo expected");
-    const int out_blob_h = static_cast<int>(blob->getTensorDesc().getDims()[2]);
-    const int out_blob_w = static_cast<int>(blob->getTensorDesc().getDims()[3]);
+    const InferenceEngine::SizeVector dims = blob->getTensorDesc().getDims();
+    if (batchIndex >= dims[0])
+        throw std::out_of_range("Image " + std::to_string(batchIndex) + " is not in the batch of " + std::to_string(dims[0]) +
+        " of output " + layer->name);
+    const int out_blob_h = static_cast<int>(dims[2]);
+    const int out_blob_w = static_cast<int>(dims[3]);
     if (out_blob_h != out_blob_w)
         throw std::runtime_error("Invalid size of output " + layer->name +
         " It should be in NCHW layout and H should be equal to W. Current H = " + std::to_string(out_blob_h) +
@@ -83,8 +87,18 @@ void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const Inferenc
         }
     }
     
+    // Images of a batch follow each other, NCHW
+    const float *output_blob = blob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>() +
+                               batchIndex * dims[1] * dims[2] * dims[3];
+    ParseYOLOV3Region(output_blob, side, num, coords, classes, anchors.data() + anchor_offset,
+                      resized_im_h, resized_im_w, original_im_h, original_im_w, threshold, objects);
+}
+
+void ParseYOLOV3Region(const float *output_blob, int side, int num, int coords, int classes, const float *anchors,
+                       const unsigned long resized_im_h, const unsigned long resized_im_w,
+                       const unsigned long original_im_h, const unsigned long original_im_w,
+                       const double threshold, std::vector<DetectionObject> &objects) {
     auto side_square = side * side;
-    const float *output_blob = blob->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::FP32>::value_type *>();
     // --------------------------- Parsing YOLO Region output -------------------------------------
     for (int i = 0; i < side_square; ++i) {
         int row = i / side;
@@ -99,8 +113,8 @@ void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const Inferenc
             }
             double x = (col + output_blob[box_index + 0 * side_square]) / side * resized_im_w;
             double y = (row + output_blob[box_index + 1 * side_square]) / side * resized_im_h;
-            double height = std::exp(output_blob[box_index + 3 * side_square]) * anchors[anchor_offset + 2 * n + 1];
-            double width = std::exp(output_blob[box_index + 2 * side_square]) * anchors[anchor_offset + 2 * n];
+            double height = std::exp(output_blob[box_index + 3 * side_square]) * anchors[2 * n + 1];
+            double width = std::exp(output_blob[box_index + 2 * side_square]) * anchors[2 * n];
             for (int j = 0; j < classes; ++j) {
                 int class_index = EntryIndex(side, coords, classes, n * side_square + i, coords + 1 + j);
                 float prob = scale * output_blob[class_index];
@@ -115,30 +129,41 @@ void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const Inferenc
     }
 }
 
+void FilterOverlappingBoxes(std::vector<DetectionObject> &objects, float iou_threshold) {
+    // Most confident first, so it is the box kept out of the ones overlapping it
+    std::sort(objects.begin(), objects.end(), [](const DetectionObject &a, const DetectionObject &b) { return b < a; });
+    for (int i = 0; i < objects.size(); ++i) {
+        if (objects[i].confidence == 0)
+            continue;
+        for (int j = i + 1; j < objects.size(); ++j)
+            if (IntersectionOverUnion(objects[i], objects[j]) >= iou_threshold)
+                objects[j].confidence = 0;
+    }
+}
+
 void YoloDetection::submitRequest() {
     if (! this -> enquedFrames) return;
+    this -> requestFrames[this -> inputRequestIdx] = this -> enquedFrames;
     this -> enquedFrames = 0;
     this -> BaseDetection::submitRequest();
 }
 
-void YoloDetection::enqueue(const cv::Mat &frame) {
+void YoloDetection::enqueue(const FrameRef &frame) {
     if (!this -> enabled()) return;
     if (this -> enquedFrames >= this -> maxBatch) {
-        BOOST_LOG_TRIVIAL(warning) << "Number of frames more than maximum(" << this -> maxBatch << ") processed by Vehicles detector" ;
+        BOOST_LOG_TRIVIAL(warning) << "Number of frames more than maximum(" << this -> maxBatch << ") processed by " << this -> topoName ;
         return;
     }
     if (nullptr == this -> requests[this -> inputRequestIdx]) {
-        this -> requests[this -> inputRequestIdx] = this -> net.CreateInferRequestPtr();
+        this -> createRequest();
     }
-    this -> width = frame.cols;
-    this -> height = frame.rows;
 	InferenceEngine::Blob::Ptr inputBlob;
     if (this -> auto_resize) {
-        inputBlob = wrapMat2Blob(frame);
+        inputBlob = wrapRegion2Blob(frame.image());
         this -> requests[this -> inputRequestIdx]->SetBlob(this -> input_name, inputBlob);
     } else {
 		inputBlob = this -> requests[this -> inputRequestIdx]->GetBlob(this -> input_name);
-		matU8ToBlob<uint8_t >(frame, inputBlob, this -> enquedFrames);
+		frameRegion2Blob(frame, inputBlob, this -> enquedFrames);
     }
     this -> enquedFrames++;
 }
@@ -148,9 +173,8 @@ InferenceEngine::CNNNetwork YoloDetection::read() {
     InferenceEngine::CNNNetReader netReader;
     /** Reading network model **/
     netReader.ReadNetwork(this -> commandLineFlag);
-    /** Setting batch size to 1 **/
-    BOOST_LOG_TRIVIAL(info) << "Batch size is forced to  1." ;
-    netReader.getNetwork().setBatchSize(1);
+    netReader.getNetwork().setBatchSize(this -> maxBatch);
+    BOOST_LOG_TRIVIAL(info) << "Batch size is set to " << netReader.getNetwork().getBatchSize() << " for " << this -> topoName ;
     /** Extracting the model name and loading its weights **/
     std::string binFileName = fileNameNoExt(this -> commandLineFlag) + ".bin";
     netReader.ReadWeights(binFileName);
@@ -170,8 +194,9 @@ InferenceEngine::CNNNetwork YoloDetection::read() {
         throw std::logic_error("This demo accepts networks that have only one input");
     }
     InferenceEngine::InputInfo::Ptr& input = inputInfo.begin()->second;
-    this -> resized_im_h = input.get()->getTensorDesc().getDims()[0];
-    this -> resized_im_w = input.get()->getTensorDesc().getDims()[1];
+    // Dims are NCHW whatever the layout
+    this -> resized_im_h = input.get()->getTensorDesc().getDims()[2];
+    this -> resized_im_w = input.get()->getTensorDesc().getDims()[3];
     auto inputName = inputInfo.begin()->first;
     this -> input_name = inputName;
     input->setPrecision(InferenceEngine::Precision::U8);
@@ -197,40 +222,45 @@ InferenceEngine::CNNNetwork YoloDetection::read() {
     return this -> net_readed;
 }
 
-void YoloDetection::fetchResults(int inputBatchSize) {
+void YoloDetection::fetchResults(const std::vector<cv::Rect> &frameRegions) {
     if (!this -> enabled()) return;
     if (nullptr == this -> outputRequest) {
 	    return;
     }
     this -> results.clear();
-    
-    std::vector<DetectionObject> objects;
-    // Parsing outputs
+
+    std::vector<std::pair<InferenceEngine::CNNLayerPtr, InferenceEngine::Blob::Ptr>> outputs;
     for (auto && i : this -> output) {
-        InferenceEngine::CNNLayerPtr layer = net_readed.getLayerByName(i.c_str());
-        InferenceEngine::Blob::Ptr blob = outputRequest->GetBlob(i);
-        ParseYOLOV3Output(layer, blob, this -> resized_im_h, this -> resized_im_w, this -> height, this -> width, this -> detection_threshold, objects);
-    }
-    // Filtering overlapping boxes
-    std::sort(objects.begin(), objects.end());
-    for (int i = 0; i < objects.size(); ++i) {
-        if (objects[i].confidence == 0)
-            continue;
-        for (int j = i + 1; j < objects.size(); ++j)
-            if (IntersectionOverUnion(objects[i], objects[j]) >= this ->olb_threshold)
-                objects[j].confidence = 0;
-    }
-    int j = 0;
-    for(auto && i : objects){
-        Result r;
-        if(i.confidence < this -> detection_threshold)
-            continue;
-        r.batchIndex = 0;
-        j++;
-        r.label = i.class_id;
-        r.confidence = i.confidence;
-        r.location = cv::Rect(cv::Point2f(i.xmin,i.ymin), cv::Point2f(i.xmax,i.ymax));
-        this -> results.push_back(r);
+        outputs.emplace_back(net_readed.getLayerByName(i.c_str()), outputRequest->GetBlob(i));
     }
+    ParseYOLOV3Batch(outputs, frameRegions, this -> requestFrames[this -> outputRequestIdx], this -> resized_im_h, this -> resized_im_w,
+                     this -> detection_threshold, this -> olb_threshold, this -> results);
     this -> outputRequest = nullptr;
 }
+
+void ParseYOLOV3Batch(const std::vector<std::pair<InferenceEngine::CNNLayerPtr, InferenceEngine::Blob::Ptr>> &outputs,
+                      const std::vector<cv::Rect> &frameRegions, size_t frames,
+                      const unsigned long resized_im_h, const unsigned long resized_im_w,
+                      const double threshold, const float iou_threshold, std::vector<BaseDetection::Result> &results) {
+    std::vector<DetectionObject> objects;
+    // Every frame of the batch is parsed and filtered on its own, in its own
+    // size: frames may come from streams with different resolutions and areas of interest
+    for (size_t b = 0; b < std::min(frames, frameRegions.size()); b++) {
+        const cv::Rect &region = frameRegions[b];
+        objects.clear();
+        for (auto && i : outputs) {
+            ParseYOLOV3Output(i.first, i.second, b, resized_im_h, resized_im_w, region.height, region.width, threshold, objects);
+        }
+        FilterOverlappingBoxes(objects, iou_threshold);
+        for(auto && i : objects){
+            BaseDetection::Result r;
+            if(i.confidence < threshold)
+                continue;
+            r.batchIndex = static_cast<int>(b);
+            r.label = i.class_id;
+            r.confidence = i.confidence;
+            r.location = cv::Rect(cv::Point2f(i.xmin,i.ymin), cv::Point2f(i.xmax,i.ymax)) + region.tl();
+            results.push_back(r);
+        }
+    }
+}
@@ -30,11 +30,32 @@ struct DetectionObject {
 
 double IntersectionOverUnion(const DetectionObject &box_1, const DetectionObject &box_2);
 
-void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const InferenceEngine::Blob::Ptr &blob, const unsigned long resized_im_h,
-                       const unsigned long resized_im_w, const unsigned long original_im_h,
-                       const unsigned long original_im_w,
+// Decode the boxes of image batchIndex in the RegionYolo output blob of layer,
+// in the coordinates of that image of original_im_w x original_im_h
+void ParseYOLOV3Output(const InferenceEngine::CNNLayerPtr &layer, const InferenceEngine::Blob::Ptr &blob, size_t batchIndex,
+                       const unsigned long resized_im_h, const unsigned long resized_im_w,
+                       const unsigned long original_im_h, const unsigned long original_im_w,
                        const double threshold, std::vector<DetectionObject> &objects);
 
+// Decode the boxes of one RegionYolo output in NCHW layout, side x side cells
+// of num anchors. anchors points at the 2 * num sizes used by this output.
+void ParseYOLOV3Region(const float *output_blob, int side, int num, int coords, int classes, const float *anchors,
+                       const unsigned long resized_im_h, const unsigned long resized_im_w,
+                       const unsigned long original_im_h, const unsigned long original_im_w,
+                       const double threshold, std::vector<DetectionObject> &objects);
+
+// Parse and filter the first frames images of a batch of RegionYolo outputs, each
+// in the coordinates of its frame region. The frames past them were not enqueued
+// in the request, beyond its batch size, and get no results.
+void ParseYOLOV3Batch(const std::vector<std::pair<InferenceEngine::CNNLayerPtr, InferenceEngine::Blob::Ptr>> &outputs,
+                      const std::vector<cv::Rect> &frameRegions, size_t frames,
+                      const unsigned long resized_im_h, const unsigned long resized_im_w,
+                      const double threshold, const float iou_threshold, std::vector<BaseDetection::Result> &results);
+
+// Sort the objects by descending confidence and zero the confidence of every
+// box overlapping a more confident one by iou_threshold or more
+void FilterOverlappingBoxes(std::vector<DetectionObject> &objects, float iou_threshold);
+
 class YoloDetection : public BaseDetection{
   public:
 	std::string input_name;
@@ -48,9 +69,7 @@ class YoloDetection : public BaseDetection{
 
     unsigned long resized_im_h = 0;
     unsigned long resized_im_w = 0;
-        
-    float width = 0;
-    float height = 0;
+
     using BaseDetection::operator=;
 
     // detection_threshold = FLAGS_t; olb_threshold = FLAGS_iou_t
@@ -62,11 +81,11 @@ class YoloDetection : public BaseDetection{
     
     void submitRequest() override;
 
-    void enqueue(const cv::Mat &frame) override;
+    void enqueue(const FrameRef &frame) override;
     
     InferenceEngine::CNNNetwork read() override ;
 
-    void fetchResults(int inputBatchSize) override;
+    void fetchResults(const std::vector<cv::Rect> &frameRegions) override;
 
     
 };